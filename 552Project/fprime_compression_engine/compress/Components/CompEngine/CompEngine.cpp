@@ -1,5 +1,7 @@
 #include "compress/Components/CompEngine/CompEngine.hpp"
+#include "compress/Lib/CompressionLib/Codecs.hpp"
 #include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include <algorithm>
 #include <cstring>
 #include <unistd.h> 
 #include <fstream>
@@ -8,6 +10,10 @@
 
 namespace COMP {
 
+  // Input size the working memory is reserved for at init; larger files
+  // grow it on their first run and it stays that size from then on
+  constexpr std::uint64_t kWorkspaceInputBytes = 4U * 1024U * 1024U;
+
   // ------------------------------------------------------------------
   // Construction / init
   // ------------------------------------------------------------------
@@ -20,6 +26,19 @@ namespace COMP {
 
   void CompEngine::init(FwIndexType queueDepth, FwIndexType msgSize) {
     CompEngineComponentBase::init(queueDepth, msgSize);
+
+    // Reserve for every codec in the library at its default level up
+    // front so jobs of that size run without touching the heap. Codecs
+    // whose memory grows with the input (DCT) allocate for themselves.
+    for (std::size_t a = 0; a < CompressionLib::kCodecSlots; ++a) {
+      const CompressionLib::Codec* codec =
+          CompressionLib::findCodec(static_cast<CompressionLib::Algorithm>(a));
+      if (codec == nullptr || codec->maxMemory(codec->defaultLevel()) == 0) {
+        continue;
+      }
+      this->m_context.reserve(CompressionLib::compressionWorkspace(
+          codec->algorithm(), codec->defaultLevel(), kWorkspaceInputBytes));
+    }
   }
 
   // ------------------------------------------------------------------
@@ -68,15 +87,14 @@ namespace COMP {
       return sec * 1000000U + static_cast<U32>(usec);
   }
 
+  // Library codec for an F´ algorithm; null if it is not built in
+  const CompressionLib::Codec* codecFor(COMP::Algo algo) {
+    return CompressionLib::findCodec(static_cast<CompressionLib::Algorithm>(
+        static_cast<std::uint8_t>(algo)));
+  }
+
   bool CompEngine::algoIsValid(COMP::Algo algo) const {
-    switch (algo) {
-      case COMP::Algo::HUFFMAN:
-      case COMP::Algo::LZSS:
-      case COMP::Algo::DCT:
-        return true;
-      default:
-        return false;
-    }
+    return codecFor(algo) != nullptr;
   }
 
   U32 CompEngine::doFileCompression(
@@ -90,8 +108,21 @@ namespace COMP {
         static_cast<std::uint8_t>(algo)
     );
 
+    // Level from the CompressionLevel parameter, else the codec's own
+    // default; clamped here so telemetry shows the level that runs
+    Fw::ParamValid valid = Fw::ParamValid::INVALID;
+    U8 level = this->paramGet_CompressionLevel(valid);
+    if (valid != Fw::ParamValid::VALID && valid != Fw::ParamValid::DEFAULT) {
+      const CompressionLib::Codec* codec = codecFor(algo);
+      level = static_cast<U8>((codec != nullptr) ? codec->defaultLevel()
+                                                 : CompressionLib::kDefaultLevel);
+    }
+    level = static_cast<U8>(std::min<int>(
+        std::max<int>(level, CompressionLib::kMinLevel), CompressionLib::kMaxLevel));
+    this->tlmWrite_LastLevel(level);
+
     CompressionLib::Result r =
-        CompressionLib::compressFile(libAlgo, path.toChar());
+        CompressionLib::compressFile(this->m_context, libAlgo, path.toChar(), level);
 
     bytesIn  = r.bytesIn;
     bytesOut = r.bytesOut;
@@ -114,7 +145,7 @@ namespace COMP {
       const std::string inputPath(path.toChar());
 
       // Call into your library: it decides how to name the decompressed output file
-      CompressionLib::Result res = CompressionLib::decompressFile(libAlgo, inputPath);
+      CompressionLib::Result res = CompressionLib::decompressFile(this->m_context, libAlgo, inputPath);
 
       // Propagate byte counts back to the command handler
       bytesIn  = res.bytesIn;   // adjust field names if different
@@ -328,20 +359,28 @@ namespace COMP {
         COMP::Algo algo,
         const Fw::CmdStringArg& inputPath
     ) {
-        // 1) Validate algorithm
-        if (!this->algoIsValid(algo)) {
-            this->log_WARNING_LO_InvalidAlgorithm(static_cast<U8>(algo));
+        // (Optional) validate paths are non-empty
+        if (inputPath.toChar()[0] == '\0') {
             this->cmdResponse_out(opCode, cmdSeq, Fw::CmdResponse::FORMAT_ERROR);
             return;
         }
 
-        // (Optional) validate paths are non-empty
-        if (inputPath.toChar()[0] == '\0') {
+        // 1) The codec comes from the file's header; algo only stands in
+        //    for files without one (V1 .lzss), so only then must it be valid
+        COMP::Algo used = algo;
+        CompressionLib::Algorithm detected = CompressionLib::Algorithm::HUFFMAN;
+        if (CompressionLib::detectAlgorithm(inputPath.toChar(), detected)) {
+            used = COMP::Algo(static_cast<COMP::Algo::T>(detected));
+            if (static_cast<U8>(used) != static_cast<U8>(algo)) {
+                this->log_WARNING_LO_AlgorithmMismatch(algo, used);
+            }
+        } else if (!this->algoIsValid(algo)) {
+            this->log_WARNING_LO_InvalidAlgorithm(static_cast<U8>(algo));
             this->cmdResponse_out(opCode, cmdSeq, Fw::CmdResponse::FORMAT_ERROR);
             return;
         }
 
-        this->log_ACTIVITY_HI_DecompressionRequested(algo, inputPath);
+        this->log_ACTIVITY_HI_DecompressionRequested(used, inputPath);
 
         // CPU + time start
         CpuSample cpuStart{};
@@ -352,7 +391,7 @@ namespace COMP {
         U32 bytesIn  = 0U;
         U32 bytesOut = 0U;
         const U32 result = this->doFileDecompression(
-            algo,
+            used,
             inputPath,
             bytesIn,
             bytesOut
@@ -386,7 +425,7 @@ namespace COMP {
         if (result == 0U) {
             this->log_ACTIVITY_LO_DecompressionSucceeded(bytesIn, bytesOut);
 
-            this->tlmWrite_LastAlgo(algo);
+            this->tlmWrite_LastAlgo(used);
             const F32 ratio =
                 (bytesIn > 0U) ? static_cast<F32>(bytesOut) / static_cast<F32>(bytesIn) : 0.0F;
             this->tlmWrite_LastRatio(ratio);
@@ -399,7 +438,7 @@ namespace COMP {
             Fw::LogStringArg outLog(basenameC(outC));
 
             this->log_ACTIVITY_HI_AlgoRunSummary(
-                algo,
+                used,
                 COMP::OperationKind::DECOMPRESS,
                 inLog,
                 bytesIn,
@@ -414,7 +453,7 @@ namespace COMP {
         } else {
             this->log_WARNING_HI_DecompressionFailed(result);
 
-            this->tlmWrite_LastAlgo(algo);
+            this->tlmWrite_LastAlgo(used);
             this->tlmWrite_LastRatio(0.0F);
             this->tlmWrite_LastResultCode(result);
 
@@ -425,6 +464,93 @@ namespace COMP {
 
 
 
+  void CompEngine::DECOMPRESS_RANGE_cmdHandler(
+      FwOpcodeType opCode,
+      U32 cmdSeq,
+      const Fw::CmdStringArg& inputPath,
+      U64 offset,
+      U64 length
+  ) {
+    if (inputPath.toChar()[0] == '\0') {
+      this->cmdResponse_out(opCode, cmdSeq, Fw::CmdResponse::FORMAT_ERROR);
+      return;
+    }
+
+    this->log_ACTIVITY_HI_RangeDecompressionRequested(inputPath, offset, length);
+
+    CpuSample cpuStart{};
+    sampleCpu(cpuStart);
+    const Fw::Time start = this->getTime();
+
+    // The codec comes from the file, as for DECOMPRESS_FILE. A file it
+    // cannot be read from has no block index either, so the range fails.
+    CompressionLib::Algorithm libAlgo = CompressionLib::Algorithm::HUFFMAN;
+    const bool detected = CompressionLib::detectAlgorithm(inputPath.toChar(), libAlgo);
+    const COMP::Algo algo(static_cast<COMP::Algo::T>(libAlgo));
+
+    CompressionLib::Result r = CompressionLib::decompressRange(
+        this->m_context, inputPath.toChar(), offset, length);
+    const U32 result = (r.error == 0) ? 0U : static_cast<U32>(-r.error);
+
+    const Fw::Time end = this->getTime();
+    const U32 durationUsec = diffUsec(start, end);
+
+    CpuSample cpuEnd{};
+    sampleCpu(cpuEnd);
+
+    long cpuDeltaUsec = cpuEnd.usec - cpuStart.usec;
+    float cpuPct = 0.0f;
+    if (durationUsec > 0U && cpuDeltaUsec > 0L) {
+        cpuPct = 100.0f * static_cast<float>(cpuDeltaUsec) /
+                        static_cast<float>(durationUsec);
+    }
+    if (cpuPct < 0.0f)   cpuPct = 0.0f;
+    if (cpuPct > 100.0f) cpuPct = 100.0f;
+
+    const U16 avgCpuTimes100 = static_cast<U16>(cpuPct * 100.0f + 0.5f);
+
+    U32 rssKiB = 0;
+    if (!readRssKiB(rssKiB)) {
+        rssKiB = 0;
+    }
+
+    if (result == 0U) {
+        this->log_ACTIVITY_LO_DecompressionSucceeded(r.bytesIn, r.bytesOut);
+
+        this->tlmWrite_LastAlgo(algo);
+        const F32 ratio =
+            (r.bytesIn > 0U) ? static_cast<F32>(r.bytesOut) / static_cast<F32>(r.bytesIn) : 0.0F;
+        this->tlmWrite_LastRatio(ratio);
+        this->tlmWrite_LastResultCode(0U);
+
+        Fw::LogStringArg inLog(basenameC(inputPath.toChar()));
+
+        this->log_ACTIVITY_HI_AlgoRunSummary(
+            algo,
+            COMP::OperationKind::DECOMPRESS,
+            inLog,
+            r.bytesIn,
+            r.bytesOut,
+            ratio,
+            durationUsec,
+            avgCpuTimes100,
+            rssKiB
+        );
+
+        this->cmdResponse_out(opCode, cmdSeq, Fw::CmdResponse::OK);
+    } else {
+        this->log_WARNING_HI_DecompressionFailed(result);
+
+        if (detected) {
+            this->tlmWrite_LastAlgo(algo);
+        }
+        this->tlmWrite_LastRatio(0.0F);
+        this->tlmWrite_LastResultCode(result);
+
+        this->cmdResponse_out(opCode, cmdSeq, Fw::CmdResponse::EXECUTION_ERROR);
+    }
+  }
+
   void CompEngine::SET_DEFAULT_ALGO_cmdHandler(
       FwOpcodeType opCode,
       U32 cmdSeq,
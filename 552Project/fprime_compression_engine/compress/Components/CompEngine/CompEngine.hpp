@@ -3,6 +3,7 @@
 
 #include "Fw/FPrimeBasicTypes.hpp"
 #include "compress/Components/CompEngine/CompEngineComponentAc.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
 
 namespace COMP {
 
@@ -52,9 +53,18 @@ namespace COMP {
         U32 key
     ) override;
 
+    void DECOMPRESS_RANGE_cmdHandler(
+        FwOpcodeType opCode,
+        U32 cmdSeq,
+        const Fw::CmdStringArg& inputPath,
+        U64 offset,
+        U64 length
+    ) override;
+
     // ------------------------------------------------------------------
     // Helpers
     // ------------------------------------------------------------------
+    // True if the library was built with a codec for 'algo'
     bool algoIsValid(COMP::Algo algo) const;
 
     // returns 0 on success, nonzero on error
@@ -83,6 +93,9 @@ namespace COMP {
   private:
     // runtime working copy of DefaultAlgo
     COMP::Algo m_runtimeDefaultAlgo;
+
+    // Working memory shared by every file job on this component's thread
+    CompressionLib::Context m_context;
   };
 
 } // namespace COMP
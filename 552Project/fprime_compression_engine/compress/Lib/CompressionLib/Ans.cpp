@@ -0,0 +1,519 @@
+#include "compress/Lib/CompressionLib/Ans.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/Histogram.hpp"
+
+namespace CompressionLib {
+
+namespace {
+
+// States live in [kLow, kLow << 16); renormalization moves one u16 word,
+// and since the probability scale is at most kLow one word per symbol is
+// always enough
+constexpr std::uint32_t kLow    = 1u << 16;
+constexpr std::size_t   kStates = 4;
+// Payload head: the final states, then the byte sizes of word streams
+// 0..2 (stream 3 is the rest)
+constexpr std::size_t   kHeadBytes = 4 * kStates + 4 * (kStates - 1);
+
+// ---------- Helpers for endian-safe header I/O ----------
+
+std::uint64_t getLe(const std::uint8_t* p, std::size_t bytes) {
+  std::uint64_t v = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+  }
+  return v;
+}
+
+void putLe(std::uint8_t* p, std::uint64_t v, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+  }
+}
+
+// LEB128: 7 value bits per byte, high bit set on all but the last byte
+void putVarint(std::pmr::vector<std::uint8_t>& out, std::uint64_t v) {
+  while (v >= 0x80u) {
+    out.push_back(static_cast<std::uint8_t>((v & 0x7Fu) | 0x80u));
+    v >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool getVarint(const std::uint8_t*& ip,
+               const std::uint8_t* iend,
+               std::uint64_t& v) {
+  v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (ip >= iend) {
+      return false;
+    }
+    const std::uint8_t b = *ip++;
+    v |= static_cast<std::uint64_t>(b & 0x7Fu) << shift;
+    if ((b & 0x80u) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ---------- Frequency table ----------
+
+// Scale counts (summing to total > 0) to frequencies summing to
+// 2^probBits, keeping every present symbol at 1 or more. Starts from the
+// rounded-down share, then moves single units to wherever they change the
+// coded size most: symbol s costs counts[s] * log2(2^probBits / freqs[s])
+// bits.
+void normalizeFrequencies(const std::uint64_t* counts,
+                          std::uint64_t total,
+                          std::uint32_t probBits,
+                          std::uint32_t* freqs) {
+  const std::uint32_t scale = 1u << probBits;
+  std::uint32_t sum = 0;
+  for (std::size_t s = 0; s < 256; ++s) {
+    freqs[s] = 0;
+    if (counts[s] > 0) {
+      const std::uint64_t share = counts[s] * scale / total;
+      freqs[s] = static_cast<std::uint32_t>(std::max<std::uint64_t>(share, 1));
+      sum += freqs[s];
+    }
+  }
+
+  while (sum < scale) {
+    std::size_t best = 256;
+    double bestGain = -1.0;
+    for (std::size_t s = 0; s < 256; ++s) {
+      if (counts[s] > 0) {
+        const double gain = static_cast<double>(counts[s]) *
+                            std::log2((freqs[s] + 1.0) / freqs[s]);
+        if (gain > bestGain) {
+          bestGain = gain;
+          best = s;
+        }
+      }
+    }
+    ++freqs[best];
+    ++sum;
+  }
+  while (sum > scale) {
+    std::size_t best = 256;
+    double bestLoss = 0.0;
+    for (std::size_t s = 0; s < 256; ++s) {
+      if (freqs[s] > 1) {
+        const double loss = static_cast<double>(counts[s]) *
+                            std::log2(freqs[s] / (freqs[s] - 1.0));
+        if (best == 256 || loss < bestLoss) {
+          bestLoss = loss;
+          best = s;
+        }
+      }
+    }
+    --freqs[best];
+    --sum;
+  }
+}
+
+void writeFrequencies(std::pmr::vector<std::uint8_t>& out, const std::uint32_t* freqs) {
+  std::size_t n = 256;
+  while (n > 0 && freqs[n - 1] == 0) {
+    --n;
+  }
+  putVarint(out, n);
+  for (std::size_t i = 0; i < n;) {
+    putVarint(out, freqs[i]);
+    if (freqs[i] != 0) {
+      ++i;
+      continue;
+    }
+    std::size_t run = 1;
+    while (i + run < n && run < 256 && freqs[i + run] == 0) {
+      ++run;
+    }
+    out.push_back(static_cast<std::uint8_t>(run - 1));
+    i += run;
+  }
+}
+
+// Most bytes writeFrequencies can take: the count, then up to three
+// bytes per symbol
+constexpr std::size_t kMaxTableSize = 2 + 3 * 256;
+
+bool readFrequencies(const std::uint8_t*& ip,
+                     const std::uint8_t* iend,
+                     std::uint32_t probBits,
+                     std::uint32_t* freqs) {
+  const std::uint32_t scale = 1u << probBits;
+  std::fill(freqs, freqs + 256, 0u);
+  std::uint64_t n = 0;
+  if (!getVarint(ip, iend, n) || n > 256) {
+    return false;
+  }
+  std::uint64_t sum = 0;
+  for (std::size_t i = 0; i < n;) {
+    std::uint64_t f = 0;
+    if (!getVarint(ip, iend, f) || f > scale) {
+      return false;
+    }
+    if (f != 0) {
+      freqs[i++] = static_cast<std::uint32_t>(f);
+      sum += f;
+      continue;
+    }
+    if (ip >= iend || *ip >= n - i) {
+      return false;
+    }
+    i += 1 + *ip++;
+  }
+  return sum == scale;
+}
+
+// ---------- Coder ----------
+
+struct EncSymbol {
+  std::uint32_t freq;
+  std::uint32_t cum;
+  std::uint64_t xMax;  // states at or above this renormalize first
+};
+
+void buildEncoder(const std::uint32_t* freqs, std::uint32_t probBits, EncSymbol* syms) {
+  std::uint32_t cum = 0;
+  for (std::size_t s = 0; s < 256; ++s) {
+    syms[s].freq = freqs[s];
+    syms[s].cum = cum;
+    syms[s].xMax = (static_cast<std::uint64_t>(kLow >> probBits) << 16) * freqs[s];
+    cum += freqs[s];
+  }
+}
+
+// Decoder tables: the symbol owning each slot (the low probBits of a
+// state), 2^probBits bytes from the scratch arena, and per symbol its
+// frequency and cumulative frequency. Both stay in L1 cache, where a
+// per-slot table of state updates would not.
+struct DecSymbol {
+  std::uint32_t freq;
+  std::uint32_t cum;
+};
+
+struct DecTables {
+  std::uint8_t* sym;
+  DecSymbol syms[256];
+};
+
+void buildDecoder(const std::uint32_t* freqs, DecTables& t) {
+  std::uint32_t cum = 0;
+  for (std::size_t s = 0; s < 256; ++s) {
+    std::memset(t.sym + cum, static_cast<int>(s), freqs[s]);
+    t.syms[s].freq = freqs[s];
+    t.syms[s].cum = cum;
+    cum += freqs[s];
+  }
+}
+
+// Room encodeBlock needs for n symbols: the head, and one word per
+// symbol for each stream
+std::size_t encodeBound(std::size_t n) {
+  return kHeadBytes + kStates * 2 * ((n + kStates - 1) / kStates);
+}
+
+// rANS-code ip[0..n) into the encodeBound(n) bytes at 'payload' and
+// return the payload size. Symbols are coded last to first, so each
+// state writes its words back to front, at the end of its own share of
+// the room, and the decoder reads them forwards; the streams are then
+// moved up behind the head.
+std::size_t encodeBlock(const EncSymbol* syms,
+                        std::uint32_t probBits,
+                        const std::uint8_t* ip,
+                        std::size_t n,
+                        std::uint8_t* payload) {
+  const std::size_t room = 2 * ((n + kStates - 1) / kStates);
+  std::uint8_t* end[kStates];
+  std::uint8_t* op[kStates];
+  for (std::size_t k = 0; k < kStates; ++k) {
+    end[k] = payload + kHeadBytes + (k + 1) * room;
+    op[k] = end[k];
+  }
+
+  std::uint32_t x[kStates] = {kLow, kLow, kLow, kLow};
+  for (std::size_t i = n; i-- > 0;) {
+    const std::size_t k = i % kStates;
+    std::uint32_t& state = x[k];
+    const EncSymbol& e = syms[ip[i]];
+    if (state >= e.xMax) {
+      op[k] -= 2;
+      putLe(op[k], state & 0xFFFFu, 2);
+      state >>= 16;
+    }
+    state = ((state / e.freq) << probBits) + (state % e.freq) + e.cum;
+  }
+
+  std::uint8_t* w = payload + kHeadBytes;
+  for (std::size_t k = 0; k < kStates; ++k) {
+    const auto bytes = static_cast<std::size_t>(end[k] - op[k]);
+    putLe(payload + 4 * k, x[k], 4);
+    if (k + 1 < kStates) {
+      putLe(payload + 4 * kStates + 4 * k, bytes, 4);
+    }
+    std::memmove(w, op[k], bytes);
+    w += bytes;
+  }
+  return static_cast<std::size_t>(w - payload);
+}
+
+// One symbol from state x, then the state renormalized. A state below
+// kLow takes the next word of its stream; the word is read either way
+// and both the new state and the pointer step follow from the
+// comparison arithmetically, so nothing branches on the data. Needs two
+// readable bytes at ip.
+template <std::uint32_t kBits>
+inline std::uint8_t decodeStep(const std::uint8_t* sym,
+                               const DecSymbol* syms,
+                               std::uint32_t& x,
+                               const std::uint8_t*& ip) {
+  const std::uint32_t slot = x & ((1u << kBits) - 1);
+  const std::uint8_t s = sym[slot];
+  x = syms[s].freq * (x >> kBits) + slot - syms[s].cum;
+  const std::uint32_t refill = x < kLow;
+  const auto word = static_cast<std::uint32_t>(getLe(ip, 2));
+  x ^= (x ^ ((x << 16) | word)) & (0u - refill);
+  ip += 2 * refill;
+  return s;
+}
+
+// Decode n symbols from payload [ip, iend) at kBits of precision. Each
+// state reads only its own stream, so the four decode chains share
+// nothing. The encoder started every state at kLow, so a well-formed
+// block ends with all of them back there and every word consumed.
+template <std::uint32_t kBits>
+bool decodeBlock(const DecTables& t,
+                 const std::uint8_t* ip,
+                 const std::uint8_t* iend,
+                 std::uint8_t* op,
+                 std::size_t n) {
+  if (static_cast<std::size_t>(iend - ip) < kHeadBytes) {
+    return false;
+  }
+  std::uint32_t x[kStates];
+  const std::uint8_t* p[kStates];
+  const std::uint8_t* end[kStates];
+  const std::uint8_t* stream = ip + kHeadBytes;
+  for (std::size_t k = 0; k < kStates; ++k) {
+    x[k] = static_cast<std::uint32_t>(getLe(ip + 4 * k, 4));
+    const std::uint64_t bytes = k + 1 < kStates
+        ? getLe(ip + 4 * kStates + 4 * k, 4)
+        : static_cast<std::uint64_t>(iend - stream);
+    if (bytes > static_cast<std::uint64_t>(iend - stream)) {
+      return false;
+    }
+    p[k] = stream;
+    stream += bytes;
+    end[k] = stream;
+  }
+
+  // The tables in locals, as stores through op could otherwise alias them
+  const std::uint8_t* const sym = t.sym;
+  const DecSymbol* const syms = t.syms;
+
+  // Four symbols per round, one from each state. A round takes at most
+  // one word from each stream, so as many rounds as the shortest stream
+  // has words left run without bounds checks; only the last few symbols
+  // are checked one at a time.
+  std::size_t i = 0;
+  for (;;) {
+    const std::ptrdiff_t words = std::min(std::min(end[0] - p[0], end[1] - p[1]),
+                                          std::min(end[2] - p[2], end[3] - p[3])) / 2;
+    std::size_t rounds = std::min(static_cast<std::size_t>(words), (n - i) / kStates);
+    if (rounds == 0) {
+      break;
+    }
+    for (; rounds > 0; --rounds) {
+      op[i] = decodeStep<kBits>(sym, syms, x[0], p[0]);
+      op[i + 1] = decodeStep<kBits>(sym, syms, x[1], p[1]);
+      op[i + 2] = decodeStep<kBits>(sym, syms, x[2], p[2]);
+      op[i + 3] = decodeStep<kBits>(sym, syms, x[3], p[3]);
+      i += kStates;
+    }
+  }
+  for (; i < n; ++i) {
+    const std::size_t k = i % kStates;
+    const std::uint32_t slot = x[k] & ((1u << kBits) - 1);
+    const std::uint8_t s = sym[slot];
+    op[i] = s;
+    x[k] = syms[s].freq * (x[k] >> kBits) + slot - syms[s].cum;
+    if (x[k] < kLow) {
+      if (end[k] - p[k] < 2) {
+        return false;
+      }
+      x[k] = (x[k] << 16) | static_cast<std::uint32_t>(getLe(p[k], 2));
+      p[k] += 2;
+    }
+  }
+
+  for (std::size_t k = 0; k < kStates; ++k) {
+    if (p[k] != end[k] || x[k] != kLow) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// decodeBlock for a precision read at run time, so each one's shifts and
+// masks are constants
+bool decodeBlock(const DecTables& t,
+                 std::uint32_t probBits,
+                 const std::uint8_t* ip,
+                 const std::uint8_t* iend,
+                 std::uint8_t* op,
+                 std::size_t n) {
+  static_assert(kAnsMinProbBits == 12 && kAnsMaxProbBits == 15);
+  switch (probBits) {
+    case 12: return decodeBlock<12>(t, ip, iend, op, n);
+    case 13: return decodeBlock<13>(t, ip, iend, op, n);
+    case 14: return decodeBlock<14>(t, ip, iend, op, n);
+    case 15: return decodeBlock<15>(t, ip, iend, op, n);
+    default: return false;
+  }
+}
+
+} // namespace
+
+// -------------------- Public API: container blocks --------------------
+
+std::uint32_t AnsBlockCodec::blockSize() const {
+  return std::min(std::max(m_options.blockSize, kAnsMinBlockSize), kAnsMaxBlockSize);
+}
+
+std::uint32_t AnsBlockCodec::probBits() const {
+  return std::min(std::max(m_options.probBits, kAnsMinProbBits), kAnsMaxProbBits);
+}
+
+std::size_t AnsBlockCodec::scratchBytes(std::size_t n) const {
+  // The coded block, or the decoder tables at whatever precision the
+  // parameters read later name
+  return std::max(kMaxTableSize + encodeBound(n),
+                  sizeof(DecTables) + (std::size_t{1} << kAnsMaxProbBits) + 64) + 64;
+}
+
+void AnsBlockCodec::writeParams(std::pmr::vector<std::uint8_t>& out) const {
+  out.push_back(static_cast<std::uint8_t>(probBits()));
+}
+
+bool AnsBlockCodec::readParams(const std::uint8_t* params, std::size_t size) {
+  if (size != 1 || params[0] < kAnsMinProbBits || params[0] > kAnsMaxProbBits) {
+    return false;
+  }
+  m_options.probBits = params[0];
+  return true;
+}
+
+bool AnsBlockCodec::encodeBlock(const std::uint8_t* in,
+                                std::size_t n,
+                                Arena& scratch,
+                                std::pmr::vector<std::uint8_t>& out) const {
+  (void)scratch;
+  if (n == 0) {
+    return false;
+  }
+  const std::uint32_t bits = probBits();
+  std::uint64_t counts[256];
+  histogramCount(in, n, counts);
+  std::uint32_t freqs[256];
+  normalizeFrequencies(counts, n, bits, freqs);
+
+  out.reserve(kMaxTableSize + encodeBound(n));
+  writeFrequencies(out, freqs);
+  const std::size_t tableSize = out.size();
+
+  EncSymbol syms[256];
+  buildEncoder(freqs, bits, syms);
+  out.resize(tableSize + encodeBound(n));
+  const std::size_t bytes =
+      CompressionLib::encodeBlock(syms, bits, in, n, out.data() + tableSize);
+  out.resize(tableSize + bytes);
+  return true;
+}
+
+bool AnsBlockCodec::decodeBlock(const std::uint8_t* in,
+                                std::size_t size,
+                                std::uint8_t* out,
+                                std::size_t n,
+                                Arena& scratch) const {
+  const std::uint32_t bits = probBits();
+  const std::uint8_t* ip = in;
+  const std::uint8_t* const iend = in + size;
+  std::uint32_t freqs[256];
+  if (!readFrequencies(ip, iend, bits, freqs)) {
+    return false;
+  }
+  DecTables* const tables = scratch.alloc<DecTables>(1);
+  tables->sym = scratch.alloc<std::uint8_t>(std::size_t{1} << bits);
+  buildDecoder(freqs, *tables);
+  return CompressionLib::decodeBlock(*tables, bits, ip, iend, out, n);
+}
+
+// -------------------- Public API: levels --------------------
+
+AnsOptions ansOptionsForLevel(int level) {
+  struct Preset {
+    std::uint32_t blockSize;
+    std::uint32_t probBits;
+  };
+  constexpr std::uint32_t kK = 1024;
+  static const Preset kPresets[kMaxLevel] = {
+    {4096 * kK, 15},  // 1
+    {1024 * kK, 15},  // 2
+    { 512 * kK, 14},  // 3
+    { 256 * kK, 14},  // 4
+    { 192 * kK, 14},  // 5
+    { 128 * kK, 14},  // 6 (default)
+    {  96 * kK, 14},  // 7
+    {  64 * kK, 14},  // 8
+    {  48 * kK, 14},  // 9
+    {  32 * kK, 14},  // 10
+    {  24 * kK, 14},  // 11
+    {  16 * kK, 14},  // 12
+  };
+
+  if (level < kMinLevel) level = kMinLevel;
+  if (level > kMaxLevel) level = kMaxLevel;
+
+  const Preset& p = kPresets[level - 1];
+  AnsOptions o;
+  o.blockSize = p.blockSize;
+  o.probBits  = p.probBits;
+  return o;
+}
+
+// -------------------- Codec registration --------------------
+
+namespace {
+
+class AnsCodec final : public Codec {
+public:
+  Algorithm algorithm() const override { return Algorithm::ANS; }
+  const char* name() const override { return "ANS"; }
+  const char* extension() const override { return ".ans"; }
+  CodecCapabilities capabilities() const override {
+    return kContainerCodecCapabilities;
+  }
+
+  BlockCodec* makeBlockCodec(int level, void* storage) const override {
+    static_assert(sizeof(AnsBlockCodec) <= kBlockCodecStorage);
+    return new (storage) AnsBlockCodec(ansOptionsForLevel(level));
+  }
+};
+
+const AnsCodec kAnsCodec;
+
+} // namespace
+
+const CodecRegistration ansCodecRegistration(kAnsCodec);
+
+} // namespace CompressionLib
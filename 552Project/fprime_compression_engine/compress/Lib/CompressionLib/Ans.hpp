@@ -0,0 +1,78 @@
+#ifndef COMPRESSION_LIB_ANS_HPP
+#define COMPRESSION_LIB_ANS_HPP
+
+#include <cstdint>
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
+
+namespace CompressionLib {
+
+  // Static rANS (range asymmetric numeral systems). Unlike Huffman it is
+  // not limited to whole bits per symbol, so skewed data such as sensor
+  // streams codes close to its entropy.
+  //
+  // Container blocks (see Container.hpp) each carry their own table:
+  //   the symbol frequencies normalized to 2^precision: varint count
+  //   n, then n varint frequencies, where a 0 is followed by one byte
+  //   holding the number of further zeros (symbols >= n have frequency
+  //   0); then the payload: four u32 decoder states, three u32 byte
+  //   sizes of the word streams of states 0..2 (state 3's fills the
+  //   rest), then the streams of u16 words, all little endian. Symbol i
+  //   of a block is coded by state i % 4, and each state refills from its
+  //   own stream, so the four decode chains run independently.
+  // The codec parameters are one byte, the precision (probability bits)
+  // every block uses.
+  constexpr std::uint32_t kAnsMinProbBits      = 12;
+  constexpr std::uint32_t kAnsMaxProbBits      = 15;
+  constexpr std::uint32_t kAnsDefaultProbBits  = 14;
+  constexpr std::uint32_t kAnsMinBlockSize     = 16 * 1024;
+  constexpr std::uint32_t kAnsMaxBlockSize     = 64 * 1024 * 1024;
+  constexpr std::uint32_t kAnsDefaultBlockSize = 128 * 1024;
+
+  struct AnsOptions {
+    // Input bytes per block, each with its own table, clamped to
+    // [kAnsMinBlockSize, kAnsMaxBlockSize]
+    std::uint32_t blockSize = kAnsDefaultBlockSize;
+    // Frequencies are scaled to 2^probBits, clamped to kAnsMinProbBits..
+    // kAnsMaxProbBits: more bits code closer to the entropy, but the
+    // table costs more per block and the decoder's slot table (one byte
+    // per slot) grows
+    std::uint32_t probBits = kAnsDefaultProbBits;
+  };
+
+  // Options for a compression level (see CompressionLib.hpp); smaller
+  // blocks let tables follow the data more closely, and only large
+  // blocks gain from 15-bit precision. Out-of-range levels are clamped.
+  //   1-2    4 MiB and 1 MiB blocks, 15-bit precision
+  //   3-12   512 KiB down to 16 KiB blocks (6 = 128 KiB), 14-bit
+  AnsOptions ansOptionsForLevel(int level);
+
+  class AnsBlockCodec final : public BlockCodec {
+  public:
+    explicit AnsBlockCodec(const AnsOptions& options = AnsOptions{})
+      : m_options(options) {}
+
+    std::uint32_t blockSize() const override;
+    // Precision in use: the option, clamped, or what readParams read
+    std::uint32_t probBits() const;
+    std::size_t scratchBytes(std::size_t n) const override;
+    void writeParams(std::pmr::vector<std::uint8_t>& out) const override;
+    bool readParams(const std::uint8_t* params, std::size_t size) override;
+    bool encodeBlock(const std::uint8_t* in,
+                     std::size_t n,
+                     Arena& scratch,
+                     std::pmr::vector<std::uint8_t>& out) const override;
+    bool decodeBlock(const std::uint8_t* in,
+                     std::size_t size,
+                     std::uint8_t* out,
+                     std::size_t n,
+                     Arena& scratch) const override;
+
+  private:
+    AnsOptions m_options;
+  };
+
+} // namespace CompressionLib
+
+#endif
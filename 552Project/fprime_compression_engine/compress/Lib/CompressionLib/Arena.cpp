@@ -0,0 +1,116 @@
+#include "compress/Lib/CompressionLib/Arena.hpp"
+
+#include <new>
+
+namespace CompressionLib {
+
+namespace {
+
+// Block alignment; covers every type the codecs allocate
+constexpr std::size_t kBlockAlign = 64;
+
+std::size_t alignUp(std::size_t v, std::size_t align) {
+  return (v + align - 1) & ~(align - 1);
+}
+
+} // namespace
+
+Arena::Arena(std::size_t capacity) {
+  reserve(capacity);
+}
+
+Arena::~Arena() {
+  freeSpill(nullptr);
+  ::operator delete(m_block, std::align_val_t(kBlockAlign));
+}
+
+void Arena::reserve(std::size_t capacity) {
+  reset();
+  grow(capacity);
+}
+
+void Arena::reset() {
+  freeSpill(nullptr);
+  m_used.store(0, std::memory_order_relaxed);
+  // A high-water mark past the block means the last job spilled: grow it
+  // once now rather than spilling again on every job like it
+  grow(highWater());
+}
+
+void Arena::grow(std::size_t capacity) {
+  if (capacity <= m_capacity) {
+    return;
+  }
+  capacity = alignUp(capacity, kBlockAlign);
+  void* block = ::operator new(capacity, std::align_val_t(kBlockAlign));
+  ::operator delete(m_block, std::align_val_t(kBlockAlign));
+  m_block = static_cast<std::uint8_t*>(block);
+  m_capacity = capacity;
+}
+
+Arena::Mark Arena::mark() const {
+  Mark m;
+  m.used = m_used.load(std::memory_order_relaxed);
+  m.spill = m_spill;
+  return m;
+}
+
+void Arena::release(const Mark& mark) {
+  freeSpill(mark.spill);
+  m_used.store(mark.used, std::memory_order_relaxed);
+}
+
+void* Arena::do_allocate(std::size_t bytes, std::size_t align) {
+  if (bytes == 0) {
+    bytes = 1; // distinct pointers for empty requests
+  }
+  const auto base = reinterpret_cast<std::uintptr_t>(m_block);
+  std::size_t used = m_used.load(std::memory_order_relaxed);
+  for (;;) {
+    const std::size_t begin = alignUp(base + used, align) - base;
+    if (begin > m_capacity || bytes > m_capacity - begin) {
+      return spill(bytes, align);
+    }
+    if (m_used.compare_exchange_weak(used, begin + bytes,
+                                     std::memory_order_relaxed)) {
+      noteUse(begin + bytes + m_spillBytes.load(std::memory_order_relaxed));
+      return m_block + begin;
+    }
+  }
+}
+
+void* Arena::spill(std::size_t bytes, std::size_t align) {
+  // Room for the chunk header, then 'bytes' at the requested alignment
+  const std::size_t header = alignUp(sizeof(Chunk), align);
+  auto* chunk = static_cast<Chunk*>(
+      ::operator new(header + bytes, std::align_val_t(kBlockAlign)));
+
+  std::lock_guard<std::mutex> lock(m_spillMutex);
+  chunk->next = m_spill;
+  chunk->bytes = bytes;
+  m_spill = chunk;
+  const std::size_t spilled =
+      m_spillBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  noteUse(m_used.load(std::memory_order_relaxed) + spilled);
+  return reinterpret_cast<std::uint8_t*>(chunk) + header;
+}
+
+// Chunks are taken newest first, so the ones after 'keep' lead the list
+void Arena::freeSpill(Chunk* keep) {
+  while (m_spill != keep && m_spill != nullptr) {
+    Chunk* next = m_spill->next;
+    m_spillBytes.fetch_sub(m_spill->bytes, std::memory_order_relaxed);
+    ::operator delete(m_spill, std::align_val_t(kBlockAlign));
+    m_spill = next;
+  }
+}
+
+void Arena::noteUse(std::size_t used) {
+  std::size_t seen = m_highWater.load(std::memory_order_relaxed);
+  while (used > seen &&
+         !m_highWater.compare_exchange_weak(seen, used,
+                                            std::memory_order_relaxed)) {
+  }
+}
+
+} // namespace CompressionLib
@@ -0,0 +1,108 @@
+#ifndef COMPRESSION_LIB_ARENA_HPP
+#define COMPRESSION_LIB_ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+
+namespace CompressionLib {
+
+  /**
+   * Bump allocator over one block reserved up front.
+   *
+   * allocate() moves an offset forward and deallocate() does nothing;
+   * memory comes back all at once with release() or reset(). Allocation is
+   * lock-free and safe from several threads. mark() / release() must only
+   * be used by a single thread with no other allocations in flight.
+   *
+   * If the block runs out, requests spill to heap chunks that live until
+   * reset(), which then regrows the block to the high-water mark so the
+   * next job of the same shape needs no heap at all.
+   */
+  class Arena final : public std::pmr::memory_resource {
+    struct Chunk;
+
+  public:
+    // Point to roll back to; see release()
+    struct Mark {
+      std::size_t used = 0;
+      Chunk* spill = nullptr;
+    };
+
+    explicit Arena(std::size_t capacity = 0);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Uninitialized room for n objects of a trivial type T
+    template <typename T>
+    T* alloc(std::size_t n) {
+      return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Grow the block to at least 'capacity' bytes. Drops everything
+    // allocated so far, like reset().
+    void reserve(std::size_t capacity);
+
+    // Drop everything allocated so far
+    void reset();
+
+    // Where the arena is now, and back to it: everything allocated after
+    // the mark is dropped, spill chunks included
+    Mark mark() const;
+    void release(const Mark& mark);
+
+    std::size_t capacity() const { return m_capacity; }
+    // Most bytes in use at once (block and live spill) since construction
+    std::size_t highWater() const { return m_highWater.load(std::memory_order_relaxed); }
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+      return this == &other;
+    }
+
+    // Replace an empty block with one of at least 'capacity' bytes
+    void grow(std::size_t capacity);
+    void* spill(std::size_t bytes, std::size_t align);
+    void freeSpill(Chunk* keep);
+    void noteUse(std::size_t used);
+
+    // Heap chunk taken when the block is full; chunks form a list, newest
+    // first
+    struct Chunk {
+      Chunk* next;
+      std::size_t bytes; // counted in m_spillBytes
+    };
+
+    std::uint8_t* m_block = nullptr;
+    std::size_t m_capacity = 0;
+    std::atomic<std::size_t> m_used{0};
+    std::atomic<std::size_t> m_highWater{0};
+
+    std::mutex m_spillMutex;
+    Chunk* m_spill = nullptr;
+    std::atomic<std::size_t> m_spillBytes{0}; // held by live chunks
+  };
+
+  // Rolls an arena back to where it was on construction
+  class ArenaScope {
+  public:
+    explicit ArenaScope(Arena& arena) : m_arena(arena), m_mark(arena.mark()) {}
+    ~ArenaScope() { m_arena.release(m_mark); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+  private:
+    Arena& m_arena;
+    Arena::Mark m_mark;
+  };
+
+} // namespace CompressionLib
+
+#endif
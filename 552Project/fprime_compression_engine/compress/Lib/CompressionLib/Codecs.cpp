@@ -0,0 +1,131 @@
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+
+#include <algorithm>
+#include <new>
+
+#include "compress/Lib/CompressionLib/Container.hpp"
+
+namespace CompressionLib {
+
+namespace {
+
+// Zeroed before any static initializer runs, so codecs can register in
+// any order
+const Codec* registered[kCodecSlots] = {};
+
+} // namespace
+
+// The library is a static archive, and the linker only takes a codec's
+// object file out of it if something refers to it. Nothing but this list
+// does, so it decides which codecs end up in a program: a codec the
+// build leaves out is neither compiled nor linked.
+extern const CodecRegistration* const kBuiltinCodecs[];
+const CodecRegistration* const kBuiltinCodecs[] = {
+#ifndef COMPRESSION_LIB_NO_HUFFMAN
+  &huffmanCodecRegistration,
+#endif
+#ifndef COMPRESSION_LIB_NO_LZSS
+  &lzssCodecRegistration,
+#endif
+#ifndef COMPRESSION_LIB_NO_DCT
+  &dctCodecRegistration,
+#endif
+#ifndef COMPRESSION_LIB_NO_ANS
+  &ansCodecRegistration,
+#endif
+#ifndef COMPRESSION_LIB_NO_LZH
+  &lzhCodecRegistration,
+#endif
+  nullptr
+};
+
+// -------------------- Codec defaults --------------------
+
+std::size_t Codec::maxMemory(int level) const {
+  alignas(std::max_align_t) unsigned char storage[kBlockCodecStorage];
+  BlockCodec* codec =
+      makeBlockCodec(std::min(std::max(level, kMinLevel), kMaxLevel), storage);
+  if (codec == nullptr) {
+    return 0;
+  }
+  const std::size_t bytes = codec->scratchBytes(codec->blockSize());
+  codec->~BlockCodec();
+  return bytes;
+}
+
+BlockCodec* Codec::makeBlockCodec(int level, void* storage) const {
+  (void)level;
+  (void)storage;
+  return nullptr;
+}
+
+bool Codec::ownsMagic(const std::uint8_t* magic) const {
+  (void)magic;
+  return false;
+}
+
+Result Codec::compressFile(const std::string& path, int level) const {
+  (void)path;
+  (void)level;
+  Result r{};
+  r.error = -99;
+  return r;
+}
+
+Result Codec::decompressFile(const std::string& path, Context* context) const {
+  (void)path;
+  (void)context;
+  Result r{};
+  r.error = -3;
+  return r;
+}
+
+// -------------------- Registry --------------------
+
+bool registerCodec(const Codec& codec) {
+  const auto id = static_cast<std::size_t>(codec.algorithm());
+  if (id >= kCodecSlots) {
+    return false;
+  }
+  registered[id] = &codec;
+  return true;
+}
+
+const Codec* findCodec(Algorithm algo) {
+  const auto id = static_cast<std::size_t>(algo);
+  return (id < kCodecSlots) ? registered[id] : nullptr;
+}
+
+const Codec* findCodecByMagic(const std::uint8_t* magic) {
+  for (const Codec* codec : registered) {
+    if (codec != nullptr && codec->ownsMagic(magic)) {
+      return codec;
+    }
+  }
+  return nullptr;
+}
+
+// -------------------- BlockCodecInstance --------------------
+
+BlockCodecInstance::~BlockCodecInstance() {
+  clear();
+}
+
+BlockCodec* BlockCodecInstance::emplace(Algorithm algo, int level) {
+  clear();
+  const Codec* codec = findCodec(algo);
+  if (codec != nullptr) {
+    m_codec = codec->makeBlockCodec(
+        std::min(std::max(level, kMinLevel), kMaxLevel), m_storage);
+  }
+  return m_codec;
+}
+
+void BlockCodecInstance::clear() {
+  if (m_codec != nullptr) {
+    m_codec->~BlockCodec();
+    m_codec = nullptr;
+  }
+}
+
+} // namespace CompressionLib
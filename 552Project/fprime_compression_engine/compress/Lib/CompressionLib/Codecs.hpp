@@ -0,0 +1,127 @@
+#ifndef COMPRESSION_LIB_CODECS_HPP
+#define COMPRESSION_LIB_CODECS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+
+namespace CompressionLib {
+
+  class BlockCodec; // see Container.hpp
+  class Context;    // see Context.hpp
+
+  struct CodecCapabilities {
+    bool streaming     = false; // CompressStream / DecompressStream
+    bool blockParallel = false; // container blocks coded on all cores,
+                                // so also compressBuffer and decompressRange
+    bool lossy         = false; // decodes to an approximation of the input
+  };
+
+  // What a lossless container codec can do
+  constexpr CodecCapabilities kContainerCodecCapabilities = {true, true, false};
+
+  // Room a codec's BlockCodec is built in (see BlockCodecInstance)
+  constexpr std::size_t kBlockCodecStorage = 128;
+
+  // Codec ids are a byte of the container header; the registry has a slot
+  // for each id below this
+  constexpr std::size_t kCodecSlots = 8;
+
+  /**
+   * One compression algorithm as the library drives it. A container codec
+   * provides a BlockCodec and Container.cpp does the rest: files, buffers,
+   * streams and ranges. Any other codec (DCT) reads and writes files of
+   * its own. Each codec's source file registers one instance of its Codec
+   * with a static CodecRegistration.
+   */
+  class Codec {
+  public:
+    virtual ~Codec() = default;
+
+    virtual Algorithm algorithm() const = 0;
+    virtual const char* name() const = 0;
+
+    // Suffix of the files compressFile writes
+    virtual const char* extension() const = 0;
+
+    virtual CodecCapabilities capabilities() const = 0;
+
+    // Level for callers that have none of their own
+    virtual int defaultLevel() const { return kDefaultLevel; }
+
+    // Most working memory one worker needs at 'level' however large the
+    // input: the scratch for one of the codec's largest blocks. 0 if it
+    // grows with the input instead.
+    virtual std::size_t maxMemory(int level) const;
+
+    // Build the codec's BlockCodec for 'level' (in range) in 'storage',
+    // kBlockCodecStorage bytes; null if the codec writes no containers
+    virtual BlockCodec* makeBlockCodec(int level, void* storage) const;
+
+    // True if a file starting with magic[0..4) is in the codec's own
+    // pre-container format (HUF1 is the only one with a magic)
+    virtual bool ownsMagic(const std::uint8_t* magic) const;
+
+    // For codecs without a BlockCodec: compress the file at 'path' in
+    // the codec's own format. -99 unless overridden.
+    virtual Result compressFile(const std::string& path, int level) const;
+
+    // Decompress a file in the codec's own format; a null
+    // 'context' gives the job one of its own. -3 unless overridden.
+    virtual Result decompressFile(const std::string& path,
+                                  Context* context) const;
+  };
+
+  // Put 'codec' in the registry under codec.algorithm(), in place of any
+  // codec there; false if its id is out of range. Registration happens
+  // during static initialization; the registry is read-only after that.
+  bool registerCodec(const Codec& codec);
+
+  // Registered codec for 'algo'; null if it is not built into the library
+  const Codec* findCodec(Algorithm algo);
+
+  // Registered codec that owns a file starting with magic[0..4), or null
+  const Codec* findCodecByMagic(const std::uint8_t* magic);
+
+  // A namespace-scope one of these in a codec's source file registers it
+  class CodecRegistration {
+  public:
+    explicit CodecRegistration(const Codec& codec) { registerCodec(codec); }
+  };
+
+  // Registrations of the codecs that come with the library, each defined
+  // in its codec's source file; Codecs.cpp refers to the ones the build
+  // selects (COMPRESSION_LIB_NO_<CODEC> leaves a codec out)
+  extern const CodecRegistration huffmanCodecRegistration;
+  extern const CodecRegistration lzssCodecRegistration;
+  extern const CodecRegistration dctCodecRegistration;
+  extern const CodecRegistration ansCodecRegistration;
+  extern const CodecRegistration lzhCodecRegistration;
+
+  // A registered codec's BlockCodec for one level, built in place so
+  // picking one allocates nothing
+  class BlockCodecInstance {
+  public:
+    BlockCodecInstance() = default;
+    BlockCodecInstance(Algorithm algo, int level) { emplace(algo, level); }
+    ~BlockCodecInstance();
+    BlockCodecInstance(const BlockCodecInstance&) = delete;
+    BlockCodecInstance& operator=(const BlockCodecInstance&) = delete;
+
+    // Build the BlockCodec for 'algo' at 'level' (clamped) in place of
+    // the one held; null if 'algo' is not registered or has none
+    BlockCodec* emplace(Algorithm algo, int level);
+
+    BlockCodec* get() const { return m_codec; }
+
+  private:
+    void clear();
+
+    alignas(std::max_align_t) unsigned char m_storage[kBlockCodecStorage];
+    BlockCodec* m_codec = nullptr;
+  };
+
+} // namespace CompressionLib
+
+#endif
@@ -1,42 +1,334 @@
 #include "compress/Lib/CompressionLib/CompressionLib.hpp"
 
-#include "compress/Lib/CompressionLib/Huffman.hpp"
-#include "compress/Lib/CompressionLib/Lzss.hpp"
-#include "compress/Lib/CompressionLib/Dct.hpp"
+#include <algorithm>
+#include <fstream>
+#include <optional>
+
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
+#include "compress/Lib/CompressionLib/Parallel.hpp"
 
 namespace CompressionLib {
 
-Result compressFile(Algorithm algo, const std::string& path) {
-  switch (algo) {
-    case Algorithm::HUFFMAN:
-      return huffmanCompressFile(path);
-    case Algorithm::LZSS:
-      return lzssCompressFile(path);
-    case Algorithm::DCT:
-      return dctCompressFile(path);
-    default: {
+namespace {
+
+bool endsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Same naming as the codecs' own decoders:
+// ".../dickens.txt.huff" -> ".../dickens_DC.txt"
+std::string decompressedPath(const std::string& inPath, const std::string& ext,
+                             const std::string& tag = "_DC") {
+  if (!endsWith(inPath, ext)) {
+    return inPath + tag;
+  }
+  const std::string tmp = inPath.substr(0, inPath.size() - ext.size());
+  const auto dotPos = tmp.find_last_of('.');
+  if (dotPos == std::string::npos) {
+    return tmp + tag;
+  }
+  return tmp.substr(0, dotPos) + tag + tmp.substr(dotPos);
+}
+
+// Codec and layout of the file at 'path' from its first bytes, with the
+// container header if it is one; false if it starts with no magic known
+// here
+bool detectFormat(const std::string& path, Algorithm& algo, bool& container,
+                  ContainerInfo& info) {
+  std::uint8_t head[kContainerMaxHeaderSize] = {};
+  std::ifstream in(path, std::ios::binary);
+  in.read(reinterpret_cast<char*>(head), sizeof(head));
+  const auto n = static_cast<std::size_t>(in.gcount());
+  if (n < 4) {
+    return false;
+  }
+
+  container = isContainer(head, n);
+  if (container) {
+    if (!readContainerHeader(head, n, info) || findCodec(info.codec) == nullptr) {
+      return false;
+    }
+    algo = info.codec;
+    return true;
+  }
+  const Codec* codec = findCodecByMagic(head);
+  if (codec == nullptr) {
+    return false;
+  }
+  algo = codec->algorithm();
+  return true;
+}
+
+bool detectFormat(const std::string& path, Algorithm& algo, bool& container) {
+  ContainerInfo info;
+  return detectFormat(path, algo, container, info);
+}
+
+// Bytes in the file at 'path'; 0 if it cannot be read
+std::uint64_t fileSize(const std::string& path) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  const auto size = in ? static_cast<std::streamoff>(in.tellg()) : 0;
+  return (size > 0) ? static_cast<std::uint64_t>(size) : 0;
+}
+
+// The caller's context, or else a temporary one reserved up front for
+// 'algo' at 'level' on 'bytes' of input, so the job runs in one block
+// per arena rather than spilling to the heap as it goes
+Context& jobContext(Context* context, std::optional<Context>& temporary,
+                    Algorithm algo, int level, std::uint64_t bytes) {
+  return (context != nullptr) ? *context : temporary.emplace(algo, level, bytes);
+}
+
+// Level a container was written at, for sizing a context to decode it
+int containerLevel(const ContainerInfo& info) {
+  return (info.level == 0) ? kDefaultLevel
+                           : std::min<int>(info.level, kMaxLevel);
+}
+
+// Original bytes to size that context for. A streamed header has no
+// length, but decoding one takes no more than a block per worker.
+std::uint64_t containerInput(const ContainerInfo& info) {
+  return (info.flags & kContainerStreamed) ? info.blockSize : info.length;
+}
+
+// -1 if the file cannot be read, -3 if it is in no format known here
+Result unknownFormat(const std::string& path) {
+  Result r{};
+  std::ifstream in(path, std::ios::binary);
+  r.error = in ? -3 : -1;
+  return r;
+}
+
+// A null ctx gives each job a context of its own
+Result compressWith(Context* context, Algorithm algo, const std::string& path,
+                    int level) {
+  level = std::min(std::max(level, kMinLevel), kMaxLevel);
+  const Codec* codec = findCodec(algo);
+  if (codec == nullptr) {
+    Result r{};
+    r.error = -99;
+    return r;
+  }
+  const BlockCodecInstance block(algo, level);
+  if (block.get() == nullptr) {
+    return codec->compressFile(path, level);
+  }
+
+  std::optional<Context> temporary;
+  Context& ctx = jobContext(context, temporary, algo, level, fileSize(path));
+  return containerCompressFile(path, path + codec->extension(), algo, level,
+                               *block.get(), 0, ctx);
+}
+
+// 'algo' only matters for files without a magic: V1 .lzss and DCT
+Result decompressWith(Context* context, Algorithm algo, const std::string& path) {
+  bool container = false;
+  ContainerInfo info;
+  const bool known = detectFormat(path, algo, container, info);
+
+  const Codec* codec = findCodec(algo);
+  if (container) {
+    // A container names its own codec, which may not be built in here
+    const BlockCodecInstance block(algo, kDefaultLevel);
+    if (!known || block.get() == nullptr) {
       Result r{};
-      r.error = -99;
+      r.error = -3;
       return r;
     }
+    std::optional<Context> temporary;
+    Context& ctx = jobContext(context, temporary, algo, containerLevel(info),
+                              containerInput(info));
+    return containerDecompressFile(path,
+                                   decompressedPath(path, codec->extension()),
+                                   *block.get(), 0, ctx);
+  }
+
+  if (codec == nullptr) {
+    Result r{};
+    r.error = -99;
+    return r;
   }
+  return codec->decompressFile(path, context);
+}
+
+// Only containers have a block index to seek in
+Result decompressRangeWith(Context* context, const std::string& path,
+                           std::uint64_t offset, std::uint64_t length) {
+  Algorithm algo = Algorithm::HUFFMAN;
+  bool container = false;
+  ContainerInfo info;
+  if (!detectFormat(path, algo, container, info) || !container) {
+    return unknownFormat(path);
+  }
+  const BlockCodecInstance block(algo, kDefaultLevel);
+  if (block.get() == nullptr) {
+    Result r{};
+    r.error = -3;
+    return r;
+  }
+
+  // ".../dickens.txt.lzh", 4096, 512 -> ".../dickens_DC_4096_512.txt"
+  const std::string tag =
+      "_DC_" + std::to_string(offset) + "_" + std::to_string(length);
+  const char* ext = findCodec(algo)->extension();
+  std::optional<Context> temporary;
+  Context& ctx = jobContext(context, temporary, algo, containerLevel(info),
+                            containerInput(info));
+  return containerDecompressRange(path, decompressedPath(path, ext, tag),
+                                  offset, length, *block.get(), 0, ctx);
+}
+
+Result compressBufferWith(Context* context, Algorithm algo,
+                          const std::uint8_t* in, std::size_t n,
+                          std::uint8_t* out, std::size_t cap, int level) {
+  level = std::min(std::max(level, kMinLevel), kMaxLevel);
+  const BlockCodecInstance block(algo, level);
+  if (block.get() == nullptr) {
+    Result r{};
+    r.error = -99; // DCT only compresses image files
+    return r;
+  }
+  std::optional<Context> temporary;
+  Context& ctx = jobContext(context, temporary, algo, level, n);
+  return containerCompressBuffer(in, n, out, cap, algo, level, *block.get(), 0,
+                                 ctx);
+}
+
+// Buffers are always containers
+Result decompressBufferWith(Context* context, const std::uint8_t* in,
+                            std::size_t n, std::uint8_t* out, std::size_t cap) {
+  ContainerInfo info;
+  BlockCodecInstance block;
+  if (!readContainerHeader(in, n, info) ||
+      block.emplace(info.codec, kDefaultLevel) == nullptr) {
+    Result r{};
+    r.error = -3;
+    return r;
+  }
+  std::optional<Context> temporary;
+  Context& ctx = jobContext(context, temporary, info.codec, containerLevel(info),
+                            containerInput(info));
+  return containerDecompressBuffer(in, n, out, cap, *block.get(), 0, ctx);
+}
+
+} // namespace
+
+Result compressFile(Algorithm algo, const std::string& path, int level) {
+  return compressWith(nullptr, algo, path, level);
+}
+
+Result compressFile(Context& ctx, Algorithm algo, const std::string& path,
+                    int level) {
+  return compressWith(&ctx, algo, path, level);
 }
 
 Result decompressFile(Algorithm algo, const std::string& path) {
-  switch (algo) {
-    case Algorithm::HUFFMAN:
-      return huffmanDecompressFile(path);
-    case Algorithm::LZSS:
-      return lzssDecompressFile(path);
-    case Algorithm::DCT:
-      // path should be the .dct file
-      return dctDecompressFile(path);
-    default: {
-      Result r{};
-      r.error = -99;
-      return r;
+  return decompressWith(nullptr, algo, path);
+}
+
+Result decompressFile(Context& ctx, Algorithm algo, const std::string& path) {
+  return decompressWith(&ctx, algo, path);
+}
+
+Result decompressFile(const std::string& path) {
+  Algorithm algo = Algorithm::HUFFMAN;
+  if (!detectAlgorithm(path, algo)) {
+    return unknownFormat(path);
+  }
+  return decompressWith(nullptr, algo, path);
+}
+
+Result decompressFile(Context& ctx, const std::string& path) {
+  Algorithm algo = Algorithm::HUFFMAN;
+  if (!detectAlgorithm(path, algo)) {
+    return unknownFormat(path);
+  }
+  return decompressWith(&ctx, algo, path);
+}
+
+Result decompressRange(const std::string& path, std::uint64_t offset,
+                       std::uint64_t length) {
+  return decompressRangeWith(nullptr, path, offset, length);
+}
+
+Result decompressRange(Context& ctx, const std::string& path,
+                       std::uint64_t offset, std::uint64_t length) {
+  return decompressRangeWith(&ctx, path, offset, length);
+}
+
+bool detectAlgorithm(const std::string& path, Algorithm& algo) {
+  bool container = false;
+  return detectFormat(path, algo, container);
+}
+
+std::size_t compressBound(Algorithm algo, std::size_t n, int level) {
+  const BlockCodecInstance block(algo, level);
+  return (block.get() == nullptr) ? 0 : containerBound(*block.get(), n);
+}
+
+Result compressBuffer(Algorithm algo, const std::uint8_t* in, std::size_t n,
+                      std::uint8_t* out, std::size_t cap, int level) {
+  return compressBufferWith(nullptr, algo, in, n, out, cap, level);
+}
+
+Result compressBuffer(Context& ctx, Algorithm algo, const std::uint8_t* in,
+                      std::size_t n, std::uint8_t* out, std::size_t cap,
+                      int level) {
+  return compressBufferWith(&ctx, algo, in, n, out, cap, level);
+}
+
+bool decompressedSize(const std::uint8_t* in, std::size_t n,
+                      std::uint64_t& size) {
+  ContainerInfo info;
+  if (!readContainerHeader(in, n, info)) {
+    return false;
+  }
+  if ((info.flags & kContainerStreamed) == 0) {
+    size = info.length;
+    return true;
+  }
+  // A streamed container has no length up front: sum the entries up to
+  // the end entry
+  const std::size_t entrySize = containerEntrySize(info.flags);
+  std::uint64_t at = containerHeaderSize(info) + std::uint64_t{info.paramsSize};
+  std::uint64_t length = 0;
+  for (;;) {
+    if (at > n || n - at < entrySize) {
+      return false;
+    }
+    ContainerBlock b;
+    readContainerEntry(in + at, info.flags, b);
+    if (b.size == 0 && b.rawSize == 0) {
+      break;
     }
+    length += b.rawSize;
+    at += entrySize + b.size;
+  }
+  size = length;
+  return true;
+}
+
+Result decompressBuffer(const std::uint8_t* in, std::size_t n,
+                        std::uint8_t* out, std::size_t cap) {
+  return decompressBufferWith(nullptr, in, n, out, cap);
+}
+
+Result decompressBuffer(Context& ctx, const std::uint8_t* in, std::size_t n,
+                        std::uint8_t* out, std::size_t cap) {
+  return decompressBufferWith(&ctx, in, n, out, cap);
+}
+
+Workspace compressionWorkspace(Algorithm algo, int level,
+                               std::uint64_t maxInputBytes,
+                               std::uint32_t threads) {
+  const BlockCodecInstance block(algo, level);
+  if (block.get() == nullptr) {
+    return Workspace{}; // DCT's image library allocates for itself
   }
+  return containerWorkspace(*block.get(), maxInputBytes, workerCount(threads));
 }
 
 Result compressFolder(Algorithm algo, const std::string& folder) {
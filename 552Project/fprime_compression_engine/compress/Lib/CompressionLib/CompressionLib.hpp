@@ -1,16 +1,19 @@
 #ifndef COMPRESSION_LIB_COMPRESSION_LIB_HPP
 #define COMPRESSION_LIB_COMPRESSION_LIB_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
 namespace CompressionLib {
 
-  // Must match your FPP values: 0=HUFFMAN, 1=LZSS, 2=DCT
+  // Must match your FPP values: 0=HUFFMAN, 1=LZSS, 2=DCT, 3=ANS, 4=LZH
   enum class Algorithm : std::uint8_t {
     HUFFMAN = 0,
     LZSS    = 1,
-    DCT     = 2
+    DCT     = 2,
+    ANS     = 3,
+    LZH     = 4
   };
 
   struct Result {
@@ -19,13 +22,99 @@ namespace CompressionLib {
     std::int32_t  error    = 0;   // 0 = OK, <0 = lib error, >0 = system error
   };
 
-  // Compress a single file on disk. Returns Result with sizes.
-  Result compressFile(Algorithm algo, const std::string& path);
+  // Compression levels shared by every codec: 1 = fastest ... 12 =
+  // smallest output. Each codec maps a level onto its own settings
+  // (huffmanOptionsForLevel, ansOptionsForLevel, lzssOptionsForLevel,
+  // lzhOptionsForLevel, dctQualityForLevel). The default level gives each
+  // codec its standard settings.
+  constexpr int kMinLevel     = 1;
+  constexpr int kMaxLevel     = 12;
+  constexpr int kDefaultLevel = 6;
+
+  class Context; // see Context.hpp
+
+  // Compress a single file on disk to path + ".huff" / ".lzss" / ".ans" /
+  // ".lzh" (the common container, see Container.hpp) or, for DCT, a JPEG
+  // image. Returns Result with sizes. Out-of-range levels are clamped.
+  // error is -99 for a codec the library was built without (see Codecs.hpp).
+  Result compressFile(Algorithm algo, const std::string& path,
+                      int level = kDefaultLevel);
+
+  // Same, drawing working memory from 'ctx' instead of the heap; reuse
+  // one context across jobs to avoid allocating per job
+  Result compressFile(Context& ctx, Algorithm algo, const std::string& path,
+                      int level = kDefaultLevel);
 
   // Compress all files in a folder (for now: stub)
   Result compressFolder(Algorithm algo, const std::string& folder);
 
-    Result decompressFile(Algorithm algo, const std::string& path);
+  // Decompress a file written by compressFile, or by a release before the
+  // container (HUF1 .huff, V1 .lzss). The format is read from the file;
+  // 'algo' is only used for files that carry no magic (headerless V1
+  // .lzss). error is -4 if the data does not match the checksums stored
+  // by compressFile.
+  Result decompressFile(Algorithm algo, const std::string& path);
+
+  Result decompressFile(Context& ctx, Algorithm algo, const std::string& path);
+
+  // Same, for files whose format is known from their contents alone
+  Result decompressFile(const std::string& path);
+
+  Result decompressFile(Context& ctx, const std::string& path);
+
+  // Decompress only original bytes [offset, offset + length) of a file
+  // written by compressFile, reading and decoding just the blocks that
+  // overlap them. The range is clipped to the data, so a length past the
+  // end reads to the end. Output goes next to the input with the range in
+  // its name (".../log.txt.lzh" -> ".../log_DC_<offset>_<length>.txt").
+  // bytesIn counts the compressed bytes read. Pre-container
+  // files have no block index and fail with -3.
+  Result decompressRange(const std::string& path, std::uint64_t offset,
+                         std::uint64_t length);
+
+  Result decompressRange(Context& ctx, const std::string& path,
+                         std::uint64_t offset, std::uint64_t length);
+
+  // Codec that wrote the file at 'path', from its magic; false if the
+  // file is unreadable or carries no magic this library knows
+  bool detectAlgorithm(const std::string& path, Algorithm& algo);
+
+  // Largest output compressBuffer can give for n bytes with 'algo' at
+  // 'level': an output buffer this big always fits. 0 for DCT, which
+  // only compresses image files.
+  std::size_t compressBound(Algorithm algo, std::size_t n,
+                            int level = kDefaultLevel);
+
+  // Compress in[0..n) into out[0..cap) without touching the file system,
+  // in the format compressFile writes (the same bytes for the same data
+  // and level). bytesOut is the compressed size. error is -2 if out is
+  // too small and -99 for DCT. in and out must not overlap.
+  Result compressBuffer(Algorithm algo, const std::uint8_t* in, std::size_t n,
+                        std::uint8_t* out, std::size_t cap,
+                        int level = kDefaultLevel);
+
+  Result compressBuffer(Context& ctx, Algorithm algo, const std::uint8_t* in,
+                        std::size_t n, std::uint8_t* out, std::size_t cap,
+                        int level = kDefaultLevel);
+
+  // Original size of compressBuffer output in[0..n) (its first 23 bytes
+  // are enough); false if it is not in that format. A streamed container
+  // (CompressStream) records no size up front, so for one all n bytes,
+  // up to its end entry, are needed.
+  bool decompressedSize(const std::uint8_t* in, std::size_t n,
+                        std::uint64_t& size);
+
+  // Decompress in[0..n), written by compressBuffer (or a compressFile
+  // file read into memory), into out[0..cap). error is -2 if cap is below
+  // decompressedSize, -3 if the data is in no format this handles and -4
+  // on a checksum mismatch. Blocks decode straight into out; with 64
+  // bytes to spare past the data the last one does too, and those bytes
+  // may be overwritten.
+  Result decompressBuffer(const std::uint8_t* in, std::size_t n,
+                          std::uint8_t* out, std::size_t cap);
+
+  Result decompressBuffer(Context& ctx, const std::uint8_t* in, std::size_t n,
+                          std::uint8_t* out, std::size_t cap);
 } // namespace CompressionLib
 
 #endif
@@ -0,0 +1,944 @@
+#include "compress/Lib/CompressionLib/Container.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "compress/Lib/CompressionLib/Crc32c.hpp"
+#include "compress/Lib/CompressionLib/Parallel.hpp"
+
+namespace CompressionLib {
+
+namespace {
+
+// ---------- Little-endian / varint helpers ----------
+
+std::uint64_t getLe(const std::uint8_t* p, std::size_t bytes) {
+  std::uint64_t v = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+  }
+  return v;
+}
+
+void putLe(std::uint8_t* p, std::uint64_t v, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+  }
+}
+
+// LEB128: 7 value bits per byte, high bit set on all but the last byte
+std::uint8_t* putVarint(std::uint8_t* p, std::uint64_t v) {
+  while (v >= 0x80u) {
+    *p++ = static_cast<std::uint8_t>((v & 0x7Fu) | 0x80u);
+    v >>= 7;
+  }
+  *p++ = static_cast<std::uint8_t>(v);
+  return p;
+}
+
+std::size_t varintSize(std::uint64_t v) {
+  std::size_t n = 1;
+  for (; v >= 0x80u; v >>= 7) {
+    ++n;
+  }
+  return n;
+}
+
+bool getVarint(const std::uint8_t*& ip,
+               const std::uint8_t* iend,
+               std::uint64_t& v) {
+  v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (ip >= iend) {
+      return false;
+    }
+    const std::uint8_t b = *ip++;
+    v |= static_cast<std::uint64_t>(b & 0x7Fu) << shift;
+    if ((b & 0x80u) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Largest block a container of n bytes will hold
+std::size_t slotSize(const BlockCodec& codec, std::uint64_t n) {
+  const std::uint64_t block = std::max<std::uint32_t>(codec.blockSize(), 1);
+  return static_cast<std::size_t>(std::min(block, n));
+}
+
+// ---------- Layout ----------
+
+// Flags as written for 'info': a block size and table entries only when
+// there is more than one block to tell apart
+std::uint8_t headerFlags(const ContainerInfo& info) {
+  auto flags = static_cast<std::uint8_t>(
+      info.flags & (kContainerChecksums | kContainerStreamed));
+  if ((flags & kContainerStreamed) != 0 || info.count > 1) {
+    flags |= kContainerBlocks;
+  }
+  if (info.paramsSize > 0) {
+    flags |= kContainerParams;
+  }
+  return flags;
+}
+
+// Table bytes ahead of the entries, and per entry
+std::size_t tableHead(std::uint8_t flags) {
+  return (flags & kContainerChecksums) ? 4 : 0;
+}
+
+std::size_t tableEntrySize(std::uint8_t flags) {
+  return (flags & kContainerChecksums) ? 4 + 4 : 4;
+}
+
+// Block table bytes. A streamed container has no table; its entries sit
+// ahead of the blocks, and one more ends it.
+std::uint64_t tableSize(const ContainerInfo& info) {
+  if (info.flags & kContainerStreamed) {
+    return containerEntrySize(info.flags) * (info.count + 1);
+  }
+  if (info.count == 0) {
+    return 0;
+  }
+  if ((info.flags & kContainerBlocks) == 0) {
+    return tableHead(info.flags);
+  }
+  return tableHead(info.flags) + tableEntrySize(info.flags) * info.count;
+}
+
+// Header and codec parameter bytes
+std::size_t headSize(const ContainerInfo& info) {
+  return containerHeaderSize(info) + info.paramsSize;
+}
+
+// Container bytes other than block payloads
+std::uint64_t metaSize(const ContainerInfo& info) {
+  return headSize(info) + tableSize(info);
+}
+
+// Header of a new container of 'length' bytes, the codec parameters going
+// to 'params'; false if a container cannot hold them (too many blocks or
+// oversized parameters)
+bool planContainer(const BlockCodec& codec, Algorithm algo, int level,
+                   std::uint64_t length, std::pmr::vector<std::uint8_t>& params,
+                   ContainerInfo& info) {
+  codec.writeParams(params);
+  info = ContainerInfo{};
+  info.codec  = algo;
+  info.level  = static_cast<std::uint8_t>(std::min(std::max(level, 0), 15));
+  info.length = length;
+  const std::uint64_t block = std::max<std::uint32_t>(codec.blockSize(), 1);
+  const std::uint64_t count = (length + block - 1) / block;
+  if (count > 0xFFFFFFFFull || params.size() > kContainerMaxParams) {
+    return false;
+  }
+  // A single block is as long as the data
+  info.blockSize  = static_cast<std::uint32_t>((count > 1) ? block : length);
+  info.count      = static_cast<std::uint32_t>(count);
+  info.paramsSize = static_cast<std::uint32_t>(params.size());
+  info.flags      = kContainerChecksums;
+  info.flags      = headerFlags(info);
+  return true;
+}
+
+// Header fields from the first n bytes; false if they are not a header
+// this version can decode or are cut short
+bool parseHeader(const std::uint8_t* h, std::size_t n, ContainerInfo& info) {
+  info = ContainerInfo{};
+  if (!isContainer(h, n) || n < sizeof(kContainerMagic) + 2 ||
+      (h[4] >> 4) != kContainerVersion ||
+      (h[5] & 0x0Fu) > static_cast<std::uint8_t>(Algorithm::LZH)) {
+    return false;
+  }
+  info.flags = static_cast<std::uint8_t>(h[4] & 0x0Fu);
+  info.codec = static_cast<Algorithm>(h[5] & 0x0Fu);
+  info.level = static_cast<std::uint8_t>(h[5] >> 4);
+  const bool streamed = (info.flags & kContainerStreamed) != 0;
+
+  const std::uint8_t* ip = h + sizeof(kContainerMagic) + 2;
+  std::uint64_t blockSize = 0;
+  std::uint64_t paramsSize = 0;
+  if ((!streamed && !getVarint(ip, h + n, info.length)) ||
+      ((info.flags & kContainerBlocks) && !getVarint(ip, h + n, blockSize)) ||
+      ((info.flags & kContainerParams) && !getVarint(ip, h + n, paramsSize))) {
+    return false;
+  }
+  if ((info.flags & kContainerBlocks) == 0) {
+    blockSize = info.length;
+  }
+  if (blockSize > 0xFFFFFFFFull || paramsSize > kContainerMaxParams ||
+      ((info.flags & kContainerBlocks) && blockSize == 0)) {
+    return false;
+  }
+  info.blockSize  = static_cast<std::uint32_t>(blockSize);
+  info.paramsSize = static_cast<std::uint32_t>(paramsSize);
+
+  // A streamed container's length and count come from its entries
+  if (!streamed) {
+    const std::uint64_t count =
+        (info.length == 0) ? 0 : (info.length + blockSize - 1) / blockSize;
+    if (count > 0xFFFFFFFFull) {
+      return false;
+    }
+    info.count = static_cast<std::uint32_t>(count);
+  }
+  // Only the one encoding of each header, so its size follows from info
+  return info.flags == headerFlags(info) &&
+         static_cast<std::size_t>(ip - h) == containerHeaderSize(info);
+}
+
+// At least one byte and at most blockSize, never grown by coding
+bool validBlock(const ContainerInfo& info, const ContainerBlock& b) {
+  return b.rawSize != 0 && b.rawSize <= info.blockSize && b.size <= b.rawSize;
+}
+
+// Blocks from the table of a container 'size' bytes long
+bool parseTable(const std::uint8_t* table, std::uint64_t size,
+                ContainerInfo& info, std::pmr::vector<ContainerBlock>& blocks) {
+  const bool checksums = (info.flags & kContainerChecksums) != 0;
+  const bool entries = (info.flags & kContainerBlocks) != 0;
+  if (checksums && info.count > 0) {
+    info.crc = static_cast<std::uint32_t>(getLe(table, 4));
+  }
+  const std::uint8_t* entry = table + tableHead(info.flags);
+  blocks.resize(info.count);
+  std::uint64_t rawOffset = 0;
+  std::uint64_t offset = metaSize(info);
+  for (std::uint32_t i = 0; i < info.count; ++i) {
+    ContainerBlock& b = blocks[i];
+    b.rawSize = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(info.length - rawOffset, info.blockSize));
+    if (entries) {
+      b.size = static_cast<std::uint32_t>(getLe(entry, 4));
+      b.crc = checksums ? static_cast<std::uint32_t>(getLe(entry + 4, 4)) : 0;
+      entry += tableEntrySize(info.flags);
+    } else {
+      // The one block fills the rest of the container
+      if (size - offset > b.rawSize) {
+        return false;
+      }
+      b.size = static_cast<std::uint32_t>(size - offset);
+      b.crc = info.crc;
+    }
+    if (!validBlock(info, b)) {
+      return false;
+    }
+    b.rawOffset = rawOffset;
+    b.offset = offset;
+    rawOffset += b.rawSize;
+    offset += b.size;
+  }
+  return offset == size;
+}
+
+// Blocks of a streamed container 'size' bytes long, from the entry ahead
+// of each one up to the end entry (no bytes; the checksum of the whole).
+// readAt(pos, p, n) reads n bytes at pos. Fills in length and count.
+template <typename ReadAt>
+bool walkStream(ReadAt readAt, std::uint64_t size, ContainerInfo& info,
+                std::pmr::vector<ContainerBlock>& blocks) {
+  const std::size_t entrySize = containerEntrySize(info.flags);
+  std::uint8_t entry[containerEntrySize(kContainerChecksums)];
+  std::uint64_t pos = headSize(info);
+  std::uint64_t rawOffset = 0;
+  for (;;) {
+    ContainerBlock b;
+    if (size - pos < entrySize || !readAt(pos, entry, entrySize)) {
+      return false;
+    }
+    readContainerEntry(entry, info.flags, b);
+    pos += entrySize;
+    if (b.rawSize == 0 && b.size == 0) {
+      info.crc = b.crc;
+      break;
+    }
+    if (!validBlock(info, b) || size - pos < b.size ||
+        blocks.size() == 0xFFFFFFFFu) {
+      return false;
+    }
+    b.rawOffset = rawOffset;
+    b.offset = pos;
+    blocks.push_back(b);
+    rawOffset += b.rawSize;
+    pos += b.size;
+  }
+  info.length = rawOffset;
+  info.count = static_cast<std::uint32_t>(blocks.size());
+  return pos == size;
+}
+
+// With every block decoded and checked, the table must also agree with
+// the checksum of the whole
+bool wholeChecksumMatches(const ContainerInfo& info,
+                          const std::pmr::vector<ContainerBlock>& blocks) {
+  if ((info.flags & kContainerChecksums) == 0) {
+    return true;
+  }
+  std::uint32_t crc = 0;
+  for (const ContainerBlock& b : blocks) {
+    crc = crc32cCombine(crc, b.crc, b.rawSize);
+  }
+  return crc == info.crc;
+}
+
+// ---------- Blocks ----------
+
+// A block as it goes into the container
+struct CodedBlock {
+  const std::uint8_t* data = nullptr; // the payload; the raw bytes if stored
+  std::size_t   size = 0;
+  std::uint32_t crc  = 0;             // CRC32C of the raw bytes
+};
+
+// Table entry of block 'index'; a single block has none
+void putEntry(std::uint8_t* table, const ContainerInfo& info,
+              std::uint64_t index, const CodedBlock& block) {
+  if ((info.flags & kContainerBlocks) != 0) {
+    std::uint8_t* entry = table + tableHead(info.flags) +
+                          tableEntrySize(info.flags) * index;
+    putLe(entry, block.size, 4);
+    putLe(entry + 4, block.crc, 4);
+  }
+}
+
+// The checksum of the whole heads the table of non-empty data
+void putChecksum(std::uint8_t* table, const ContainerInfo& info,
+                 std::uint32_t crc) {
+  if (info.count > 0) {
+    putLe(table, crc, 4);
+  }
+}
+
+// Worker scratch positions at the start of a batch. Coded payloads stay
+// in scratch until the batch is copied out, then all go at once.
+class ScratchMarks {
+public:
+  ScratchMarks(Context& ctx, unsigned workers, Arena& arena)
+    : m_ctx(ctx), m_marks(workers, Arena::Mark{}, &arena) {}
+
+  void mark() {
+    for (std::size_t w = 0; w < m_marks.size(); ++w) {
+      m_marks[w] = m_ctx.scratch(static_cast<unsigned>(w)).mark();
+    }
+  }
+
+  void release() {
+    for (std::size_t w = 0; w < m_marks.size(); ++w) {
+      m_ctx.scratch(static_cast<unsigned>(w)).release(m_marks[w]);
+    }
+  }
+
+private:
+  Context& m_ctx;
+  std::pmr::vector<Arena::Mark> m_marks;
+};
+
+// Code raw[i] (rawSize[i] bytes) for every i < batch into coded[i]. A
+// block the codec fails on or does not shrink is stored. Payloads are
+// left in the workers' scratch (see ScratchMarks).
+void encodeBatch(const BlockCodec& codec, const std::uint8_t* const* raw,
+                 const std::size_t* rawSize, std::size_t batch,
+                 unsigned workers, Context& ctx, CodedBlock* coded) {
+  parallelForWorkers(ctx.pool(), batch, workers, [&](std::size_t i, unsigned worker) {
+    // The checksum is taken while the block is still in cache
+    CodedBlock& c = coded[i];
+    c.crc = crc32c(0, raw[i], rawSize[i]);
+    c.data = raw[i];
+    c.size = rawSize[i];
+    // Arenas ignore deallocation, so the payload outlives 'out'
+    Arena& scratch = ctx.scratch(worker);
+    std::pmr::vector<std::uint8_t> out(&scratch);
+    if (codec.encodeBlock(raw[i], rawSize[i], scratch, out) &&
+        out.size() < rawSize[i]) {
+      c.data = out.data();
+      c.size = out.size();
+    }
+  });
+}
+
+// Decode block b from 'payload' into dst (kBlockSlack bytes to spare)
+// and check it: 0, -3 if it does not decode, -4 if its checksum does not
+// match. A stored block is checked where it lies. 'data' gets where the
+// raw bytes are.
+int decodeChecked(const BlockCodec& codec, const ContainerBlock& b,
+                  bool checksums, const std::uint8_t* payload,
+                  std::uint8_t* dst, Arena& scratch, const std::uint8_t*& data) {
+  data = payload;
+  if (b.size != b.rawSize) {
+    ArenaScope scope(scratch);
+    if (!codec.decodeBlock(payload, b.size, dst, b.rawSize, scratch)) {
+      return -3;
+    }
+    data = dst;
+  }
+  return (checksums && crc32c(0, data, b.rawSize) != b.crc) ? -4 : 0;
+}
+
+} // namespace
+
+bool isContainer(const std::uint8_t* head, std::size_t n) {
+  return n >= sizeof(kContainerMagic) &&
+         std::memcmp(head, kContainerMagic, sizeof(kContainerMagic)) == 0;
+}
+
+bool readContainerHeader(const std::uint8_t* head, std::size_t n,
+                         ContainerInfo& info) {
+  return parseHeader(head, n, info);
+}
+
+std::size_t containerHeaderSize(const ContainerInfo& info) {
+  const std::uint8_t flags = headerFlags(info);
+  std::size_t n = sizeof(kContainerMagic) + 2;
+  if ((flags & kContainerStreamed) == 0) {
+    n += varintSize(info.length);
+  }
+  if (flags & kContainerBlocks) {
+    n += varintSize(info.blockSize);
+  }
+  if (flags & kContainerParams) {
+    n += varintSize(info.paramsSize);
+  }
+  return n;
+}
+
+void writeContainerHeader(std::uint8_t* out, const ContainerInfo& info,
+                          const std::uint8_t* params) {
+  const std::uint8_t flags = headerFlags(info);
+  std::memcpy(out, kContainerMagic, sizeof(kContainerMagic));
+  out[4] = static_cast<std::uint8_t>((kContainerVersion << 4) | flags);
+  out[5] = static_cast<std::uint8_t>(static_cast<std::uint8_t>(info.codec) |
+                                     ((info.level & 0x0Fu) << 4));
+  std::uint8_t* p = out + sizeof(kContainerMagic) + 2;
+  if ((flags & kContainerStreamed) == 0) {
+    p = putVarint(p, info.length);
+  }
+  if (flags & kContainerBlocks) {
+    p = putVarint(p, info.blockSize);
+  }
+  if (flags & kContainerParams) {
+    p = putVarint(p, info.paramsSize);
+  }
+  std::copy(params, params + info.paramsSize, p);
+}
+
+void writeContainerEntry(std::uint8_t* out, std::uint8_t flags,
+                         std::uint32_t size, std::uint32_t rawSize,
+                         std::uint32_t crc) {
+  putLe(out, size, 4);
+  putLe(out + 4, rawSize, 4);
+  if (flags & kContainerChecksums) {
+    putLe(out + 8, crc, 4);
+  }
+}
+
+void readContainerEntry(const std::uint8_t* in, std::uint8_t flags,
+                        ContainerBlock& b) {
+  b.size    = static_cast<std::uint32_t>(getLe(in, 4));
+  b.rawSize = static_cast<std::uint32_t>(getLe(in + 4, 4));
+  b.crc     = (flags & kContainerChecksums)
+                  ? static_cast<std::uint32_t>(getLe(in + 8, 4)) : 0;
+}
+
+bool readContainer(std::istream& src,
+                   std::uint64_t fileSize,
+                   ContainerInfo& info,
+                   std::pmr::vector<std::uint8_t>& params,
+                   std::pmr::vector<ContainerBlock>& blocks,
+                   std::pmr::memory_resource* memory) {
+  params.clear();
+  blocks.clear();
+
+  // The header is at most this long, and may be followed by anything
+  std::uint8_t header[kContainerMaxHeaderSize];
+  src.read(reinterpret_cast<char*>(header), kContainerMaxHeaderSize);
+  if (!parseHeader(header, static_cast<std::size_t>(src.gcount()), info) ||
+      metaSize(info) > fileSize) {
+    return false;
+  }
+
+  params.resize(info.paramsSize);
+  src.clear();
+  src.seekg(static_cast<std::streamoff>(containerHeaderSize(info)), std::ios::beg);
+  src.read(reinterpret_cast<char*>(params.data()),
+           static_cast<std::streamsize>(params.size()));
+  if (static_cast<std::size_t>(src.gcount()) != params.size()) {
+    return false;
+  }
+  if (info.flags & kContainerStreamed) {
+    auto readAt = [&src](std::uint64_t pos, std::uint8_t* p, std::size_t n) {
+      src.seekg(static_cast<std::streamoff>(pos), std::ios::beg);
+      src.read(reinterpret_cast<char*>(p), static_cast<std::streamsize>(n));
+      return static_cast<std::size_t>(src.gcount()) == n;
+    };
+    return walkStream(readAt, fileSize, info, blocks);
+  }
+  std::pmr::vector<std::uint8_t> table(
+      static_cast<std::size_t>(tableSize(info)), memory);
+  src.read(reinterpret_cast<char*>(table.data()),
+           static_cast<std::streamsize>(table.size()));
+  if (static_cast<std::size_t>(src.gcount()) != table.size()) {
+    return false;
+  }
+  return parseTable(table.data(), fileSize, info, blocks);
+}
+
+bool readContainer(const std::uint8_t* data,
+                   std::size_t size,
+                   ContainerInfo& info,
+                   std::pmr::vector<std::uint8_t>& params,
+                   std::pmr::vector<ContainerBlock>& blocks) {
+  params.clear();
+  blocks.clear();
+  if (!readContainerHeader(data, size, info) || metaSize(info) > size) {
+    return false;
+  }
+  const std::uint8_t* p = data + containerHeaderSize(info);
+  params.assign(p, p + info.paramsSize);
+  if (info.flags & kContainerStreamed) {
+    auto readAt = [data](std::uint64_t pos, std::uint8_t* to, std::size_t n) {
+      std::memcpy(to, data + pos, n);
+      return true;
+    };
+    return walkStream(readAt, size, info, blocks);
+  }
+  return parseTable(p + info.paramsSize, size, info, blocks);
+}
+
+Workspace containerWorkspace(const BlockCodec& codec,
+                             std::uint64_t inputBytes,
+                             unsigned workers) {
+  const std::size_t block = slotSize(codec, inputBytes);
+  const std::size_t count =
+      (block == 0) ? 0 : static_cast<std::size_t>((inputBytes + block - 1) / block);
+
+  // Job: raw and coded block buffers per block running at once, the block
+  // table. Scratch: whatever the codec needs for one block.
+  const auto lanes = static_cast<std::size_t>(std::min<std::uint64_t>(workers, count));
+  Workspace w;
+  w.jobBytes = lanes * (2 * block + kBlockSlack + 256) +
+               count * (tableEntrySize(kContainerChecksums) + sizeof(ContainerBlock)) +
+               kContainerMaxHeaderSize + 2 * kContainerMaxParams + 64 * 1024;
+  w.scratchBytes = codec.scratchBytes(block);
+  return w;
+}
+
+std::size_t containerBound(const BlockCodec& codec, std::size_t n) {
+  // Parameters are a few bytes; keep them off the heap
+  std::array<std::uint8_t, 256> buffer;
+  std::pmr::monotonic_buffer_resource memory(buffer.data(), buffer.size());
+  std::pmr::vector<std::uint8_t> params(&memory);
+  ContainerInfo info;
+  if (!planContainer(codec, Algorithm::HUFFMAN, 0, n, params, info)) {
+    return 0;
+  }
+  const auto meta = static_cast<std::size_t>(metaSize(info));
+  return (n > std::numeric_limits<std::size_t>::max() - meta) ? 0 : meta + n;
+}
+
+// -------------------- Compress --------------------
+
+Result containerCompressFile(const std::string& inPath,
+                             const std::string& outPath,
+                             Algorithm algo,
+                             int level,
+                             const BlockCodec& codec,
+                             std::uint32_t threads,
+                             Context& ctx) {
+  ctx.reset();
+  Result r{};
+  std::ifstream src(inPath, std::ios::binary | std::ios::ate);
+  if (!src) {
+    r.error = -1;
+    return r;
+  }
+  const auto size = src.tellg();
+  if (size < 0) {
+    r.error = -1;
+    return r;
+  }
+  r.bytesIn = static_cast<std::uint32_t>(size);
+  src.seekg(0, std::ios::beg);
+
+  // ----- Header and codec parameters -----
+  const auto length = static_cast<std::uint64_t>(size);
+  Arena& arena = ctx.job();
+  std::pmr::vector<std::uint8_t> params(&arena);
+  ContainerInfo info;
+  if (!planContainer(codec, algo, level, length, params, info)) {
+    r.error = -3;
+    return r;
+  }
+  std::pmr::vector<std::uint8_t> header(headSize(info), 0, &arena);
+  writeContainerHeader(header.data(), info, params.data());
+
+  std::ofstream dst(outPath, std::ios::binary | std::ios::trunc);
+  if (!dst) {
+    r.error = -2;
+    return r;
+  }
+  // Sizes and checksums are filled in once every block is written
+  std::pmr::vector<std::uint8_t> table(
+      static_cast<std::size_t>(tableSize(info)), 0, &arena);
+  dst.write(reinterpret_cast<const char*>(header.data()),
+            static_cast<std::streamsize>(header.size()));
+  dst.write(reinterpret_cast<const char*>(table.data()),
+            static_cast<std::streamsize>(table.size()));
+  std::uint64_t total = header.size() + table.size();
+
+  // ----- Code the blocks, one batch per thread at a time -----
+  // A file of fewer blocks than threads needs a buffer per block only
+  const auto workers = static_cast<unsigned>(
+      std::min<std::uint64_t>(ctx.workersFor(threads), info.count));
+  const std::size_t slot = slotSize(codec, length);
+  std::uint8_t* slots = (slot > 0) ? arena.alloc<std::uint8_t>(workers * slot) : nullptr;
+  std::pmr::vector<const std::uint8_t*> raw(workers, nullptr, &arena);
+  std::pmr::vector<std::size_t> rawSize(workers, 0, &arena);
+  std::pmr::vector<CodedBlock> coded(workers, &arena);
+  ScratchMarks marks(ctx, workers, arena);
+  std::uint32_t fileCrc = 0;
+
+  for (std::uint64_t first = 0; first < info.count; first += workers) {
+    const std::size_t batch = static_cast<std::size_t>(
+        std::min<std::uint64_t>(info.count - first, workers));
+    for (std::size_t i = 0; i < batch; ++i) {
+      const std::uint64_t rawOffset = (first + i) * info.blockSize;
+      rawSize[i] = static_cast<std::size_t>(
+          std::min<std::uint64_t>(length - rawOffset, info.blockSize));
+      raw[i] = slots + i * slot;
+      src.read(reinterpret_cast<char*>(slots + i * slot),
+               static_cast<std::streamsize>(rawSize[i]));
+      if (static_cast<std::size_t>(src.gcount()) != rawSize[i]) {
+        r.error = -1; // file shrank while being read
+        return r;
+      }
+    }
+
+    marks.mark();
+    encodeBatch(codec, raw.data(), rawSize.data(), batch, workers, ctx,
+                coded.data());
+    for (std::size_t i = 0; i < batch; ++i) {
+      dst.write(reinterpret_cast<const char*>(coded[i].data),
+                static_cast<std::streamsize>(coded[i].size));
+      putEntry(table.data(), info, first + i, coded[i]);
+      fileCrc = crc32cCombine(fileCrc, coded[i].crc, rawSize[i]);
+      total += coded[i].size;
+    }
+    marks.release();
+  }
+
+  putChecksum(table.data(), info, fileCrc);
+  dst.seekp(static_cast<std::streamoff>(header.size()), std::ios::beg);
+  dst.write(reinterpret_cast<const char*>(table.data()),
+            static_cast<std::streamsize>(table.size()));
+  dst.close();
+  if (!dst) {
+    r.error = -2;
+    return r;
+  }
+
+  r.bytesOut = static_cast<std::uint32_t>(total);
+  r.error = 0;
+  return r;
+}
+
+Result containerCompressBuffer(const std::uint8_t* in,
+                               std::size_t n,
+                               std::uint8_t* out,
+                               std::size_t cap,
+                               Algorithm algo,
+                               int level,
+                               const BlockCodec& codec,
+                               std::uint32_t threads,
+                               Context& ctx) {
+  ctx.reset();
+  Result r{};
+  r.bytesIn = static_cast<std::uint32_t>(n);
+
+  Arena& arena = ctx.job();
+  std::pmr::vector<std::uint8_t> params(&arena);
+  ContainerInfo info;
+  if (!planContainer(codec, algo, level, n, params, info)) {
+    r.error = -3;
+    return r;
+  }
+  if (cap < metaSize(info)) {
+    r.error = -2;
+    return r;
+  }
+  writeContainerHeader(out, info, params.data());
+  std::uint8_t* table = out + headSize(info);
+  auto total = static_cast<std::size_t>(metaSize(info));
+
+  // Blocks are coded straight from 'in', and each payload is copied once:
+  // from the worker's scratch to its place in 'out'
+  const auto workers = static_cast<unsigned>(
+      std::min<std::uint64_t>(ctx.workersFor(threads), info.count));
+  std::pmr::vector<const std::uint8_t*> raw(workers, nullptr, &arena);
+  std::pmr::vector<std::size_t> rawSize(workers, 0, &arena);
+  std::pmr::vector<CodedBlock> coded(workers, &arena);
+  ScratchMarks marks(ctx, workers, arena);
+  std::uint32_t fileCrc = 0;
+
+  for (std::uint64_t first = 0; first < info.count; first += workers) {
+    const std::size_t batch = static_cast<std::size_t>(
+        std::min<std::uint64_t>(info.count - first, workers));
+    for (std::size_t i = 0; i < batch; ++i) {
+      const auto rawOffset = static_cast<std::size_t>((first + i) * info.blockSize);
+      raw[i] = in + rawOffset;
+      rawSize[i] = std::min<std::size_t>(n - rawOffset, info.blockSize);
+    }
+
+    marks.mark();
+    encodeBatch(codec, raw.data(), rawSize.data(), batch, workers, ctx,
+                coded.data());
+    for (std::size_t i = 0; i < batch; ++i) {
+      if (coded[i].size > cap - total) {
+        r.error = -2;
+        return r;
+      }
+      std::memcpy(out + total, coded[i].data, coded[i].size);
+      putEntry(table, info, first + i, coded[i]);
+      fileCrc = crc32cCombine(fileCrc, coded[i].crc, rawSize[i]);
+      total += coded[i].size;
+    }
+    marks.release();
+  }
+  putChecksum(table, info, fileCrc);
+
+  r.bytesOut = static_cast<std::uint32_t>(total);
+  r.error = 0;
+  return r;
+}
+
+// -------------------- Decompress --------------------
+
+Result containerDecompressFile(const std::string& inPath,
+                               const std::string& outPath,
+                               BlockCodec& codec,
+                               std::uint32_t threads,
+                               Context& ctx) {
+  return containerDecompressRange(inPath, outPath, 0, kContainerToEnd, codec,
+                                  threads, ctx);
+}
+
+Result containerDecompressRange(const std::string& inPath,
+                                const std::string& outPath,
+                                std::uint64_t offset,
+                                std::uint64_t length,
+                                BlockCodec& codec,
+                                std::uint32_t threads,
+                                Context& ctx) {
+  ctx.reset();
+  Result r{};
+  std::ifstream src(inPath, std::ios::binary | std::ios::ate);
+  if (!src) {
+    r.error = -1;
+    return r;
+  }
+  const auto size = src.tellg();
+  if (size < 0) {
+    r.error = -1;
+    return r;
+  }
+  src.seekg(0, std::ios::beg);
+
+  Arena& arena = ctx.job();
+  ContainerInfo info;
+  std::pmr::vector<std::uint8_t> params(&arena);
+  std::pmr::vector<ContainerBlock> blocks(&arena);
+  if (!readContainer(src, static_cast<std::uint64_t>(size), info, params,
+                     blocks, &arena) ||
+      !codec.readParams(params.data(), params.size())) {
+    r.error = -3;
+    return r;
+  }
+
+  // The range clipped to the data, and the blocks overlapping it
+  const std::uint64_t begin = std::min(offset, info.length);
+  const std::uint64_t end = begin + std::min(length, info.length - begin);
+  const auto first = static_cast<std::size_t>(
+      std::upper_bound(blocks.begin(), blocks.end(), begin,
+                       [](std::uint64_t pos, const ContainerBlock& b) {
+                         return pos < b.rawOffset + b.rawSize;
+                       }) - blocks.begin());
+  const auto last = static_cast<std::size_t>(
+      std::lower_bound(blocks.begin(), blocks.end(), end,
+                       [](const ContainerBlock& b, std::uint64_t pos) {
+                         return b.rawOffset < pos;
+                       }) - blocks.begin());
+
+  std::ofstream dst(outPath, std::ios::binary | std::ios::trunc);
+  if (!dst) {
+    r.error = -2;
+    return r;
+  }
+
+  // Coded blocks are never larger than raw ones, so one size fits both
+  std::size_t slot = 0;
+  std::uint64_t bytesRead = metaSize(info);
+  for (std::size_t i = first; i < last; ++i) {
+    slot = std::max<std::size_t>(slot, blocks[i].rawSize);
+    bytesRead += blocks[i].size;
+  }
+  const auto workers = static_cast<unsigned>(
+      std::min<std::size_t>(ctx.workersFor(threads), last - first));
+  std::pmr::vector<std::uint8_t*> packed(workers, nullptr, &arena);
+  std::pmr::vector<std::uint8_t*> raw(workers, nullptr, &arena);
+  for (unsigned i = 0; i < workers && slot > 0; ++i) {
+    packed[i] = arena.alloc<std::uint8_t>(slot);
+    raw[i] = arena.alloc<std::uint8_t>(slot + kBlockSlack);
+  }
+  std::pmr::vector<const std::uint8_t*> data(workers, nullptr, &arena);
+  std::pmr::vector<int> status(workers, 0, &arena);
+  const bool checksums = (info.flags & kContainerChecksums) != 0;
+
+  // Blocks lie back to back except in a streamed container, where an
+  // entry sits between each two
+  std::uint64_t at = 0;
+  for (std::size_t next = first; next < last; next += workers) {
+    const std::size_t batch = std::min<std::size_t>(last - next, workers);
+    for (std::size_t i = 0; i < batch; ++i) {
+      const ContainerBlock& b = blocks[next + i];
+      if (b.offset != at) {
+        src.seekg(static_cast<std::streamoff>(b.offset), std::ios::beg);
+      }
+      at = b.offset + b.size;
+      src.read(reinterpret_cast<char*>(packed[i]),
+               static_cast<std::streamsize>(b.size));
+      if (static_cast<std::size_t>(src.gcount()) != b.size) {
+        r.error = -3;
+        return r;
+      }
+    }
+
+    parallelForWorkers(ctx.pool(), batch, workers, [&](std::size_t i, unsigned worker) {
+      status[i] = decodeChecked(codec, blocks[next + i], checksums, packed[i],
+                                raw[i], ctx.scratch(worker), data[i]);
+    });
+
+    for (std::size_t i = 0; i < batch; ++i) {
+      const ContainerBlock& b = blocks[next + i];
+      if (status[i] != 0) {
+        r.error = status[i];
+        return r;
+      }
+      // Only the first and last block can stick out of the range
+      const std::uint64_t from = std::max(begin, b.rawOffset) - b.rawOffset;
+      const std::uint64_t to = std::min(end, b.rawOffset + b.rawSize) - b.rawOffset;
+      dst.write(reinterpret_cast<const char*>(data[i] + from),
+                static_cast<std::streamsize>(to - from));
+    }
+  }
+  dst.close();
+  if (!dst) {
+    r.error = -2;
+    return r;
+  }
+
+  if (first == 0 && last == blocks.size() && !wholeChecksumMatches(info, blocks)) {
+    r.error = -4;
+    return r;
+  }
+
+  r.bytesIn = static_cast<std::uint32_t>(bytesRead);
+  r.bytesOut = static_cast<std::uint32_t>(end - begin);
+  r.error = 0;
+  return r;
+}
+
+Result containerDecompressBuffer(const std::uint8_t* in,
+                                 std::size_t n,
+                                 std::uint8_t* out,
+                                 std::size_t cap,
+                                 BlockCodec& codec,
+                                 std::uint32_t threads,
+                                 Context& ctx) {
+  ctx.reset();
+  Result r{};
+  Arena& arena = ctx.job();
+  ContainerInfo info;
+  std::pmr::vector<std::uint8_t> params(&arena);
+  std::pmr::vector<ContainerBlock> blocks(&arena);
+  if (!readContainer(in, n, info, params, blocks) ||
+      !codec.readParams(params.data(), params.size())) {
+    r.error = -3;
+    return r;
+  }
+  if (info.length > cap) {
+    r.error = -2;
+    return r;
+  }
+
+  // Blocks decode straight into 'out'. A decoder may run kBlockSlack
+  // bytes into the next block, so even blocks go first and odd ones
+  // second, and the heads of even blocks the odd ones ran into are put
+  // back. A block without the slack before the end of 'out' is decoded
+  // in scratch and copied, as is every block if one before the last is
+  // shorter than the slack (never so in containers written here).
+  bool inPlace = true;
+  for (std::size_t i = 0; i + 1 < blocks.size(); ++i) {
+    inPlace = inPlace && blocks[i].rawSize >= kBlockSlack;
+  }
+  const bool checksums = (info.flags & kContainerChecksums) != 0;
+  std::pmr::vector<int> status(blocks.size(), 0, &arena);
+  auto decode = [&](std::size_t i, unsigned worker) {
+    const ContainerBlock& b = blocks[i];
+    std::uint8_t* target = out + b.rawOffset;
+    Arena& scratch = ctx.scratch(worker);
+    ArenaScope scope(scratch);
+    const bool bounce = !inPlace || b.rawSize + kBlockSlack > cap - b.rawOffset;
+    std::uint8_t* dst =
+        bounce ? scratch.alloc<std::uint8_t>(b.rawSize + kBlockSlack) : target;
+    const std::uint8_t* data = nullptr;
+    status[i] = decodeChecked(codec, b, checksums, in + b.offset, dst, scratch, data);
+    if (status[i] == 0 && data != target) {
+      std::memcpy(target, data, b.rawSize);
+    }
+  };
+
+  const unsigned workers = ctx.workersFor(threads);
+  const std::size_t evens = (blocks.size() + 1) / 2;
+  const std::size_t odds = blocks.size() / 2;
+  parallelForWorkers(ctx.pool(), evens, workers, [&](std::size_t k, unsigned worker) {
+    decode(2 * k, worker);
+  });
+  std::uint8_t* heads = (inPlace && odds > 0)
+                            ? arena.alloc<std::uint8_t>(odds * kBlockSlack)
+                            : nullptr;
+  auto headSize = [&](std::size_t i) {
+    return std::min<std::size_t>(kBlockSlack, cap - blocks[i].rawOffset);
+  };
+  for (std::size_t i = 2; heads != nullptr && i < blocks.size(); i += 2) {
+    std::memcpy(heads + (i / 2 - 1) * kBlockSlack, out + blocks[i].rawOffset,
+                headSize(i));
+  }
+  parallelForWorkers(ctx.pool(), odds, workers, [&](std::size_t k, unsigned worker) {
+    decode(2 * k + 1, worker);
+  });
+  for (std::size_t i = 2; heads != nullptr && i < blocks.size(); i += 2) {
+    std::memcpy(out + blocks[i].rawOffset, heads + (i / 2 - 1) * kBlockSlack,
+                headSize(i));
+  }
+
+  for (int s : status) {
+    if (s != 0) {
+      r.error = s;
+      return r;
+    }
+  }
+  if (!wholeChecksumMatches(info, blocks)) {
+    r.error = -4;
+    return r;
+  }
+
+  r.bytesIn = static_cast<std::uint32_t>(n);
+  r.bytesOut = static_cast<std::uint32_t>(info.length);
+  r.error = 0;
+  return r;
+}
+
+} // namespace CompressionLib
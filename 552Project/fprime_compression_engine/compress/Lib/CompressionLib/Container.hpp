@@ -0,0 +1,261 @@
+#ifndef COMPRESSION_LIB_CONTAINER_HPP
+#define COMPRESSION_LIB_CONTAINER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "compress/Lib/CompressionLib/Arena.hpp"
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
+
+namespace CompressionLib {
+
+  // Common file layout written by compressFile for the lossless codecs
+  // (Huffman, LZSS, ANS, LZH). Integers are little endian; varints are
+  // LEB128 (7 bits a byte, low first).
+  //
+  //   header:
+  //     "CMPR", u8 version (2) << 4 | flags (below), u8 codec
+  //     (Algorithm) | level << 4 (level 0 if unknown), then varints: the original length (not when streamed),
+  //     the block size (most raw bytes in any block; only with
+  //     kContainerBlocks), the codec parameter bytes (only with
+  //     kContainerParams)
+  //   codec parameters
+  //   table, for non-empty data unless streamed: u32 CRC32C of the
+  //     original data if checksummed, then, with kContainerBlocks, per
+  //     block u32 coded size and, if checksummed, u32 CRC32C of the
+  //     block's raw bytes
+  //   the blocks in order
+  //
+  // Without kContainerBlocks the data is one block (none if empty), of
+  // the length, filling the rest of the container; its checksum is that
+  // of the whole. With it, every block but the last holds block size raw
+  // bytes. The table's fields are fixed-size so a file can be written
+  // ahead of them and patched.
+  //
+  // A streamed container (flag below) is written before its length is
+  // known. In place of the table each block is preceded by its entry
+  // (containerEntrySize bytes: u32 coded size, u32 raw size, u32 CRC32C
+  // if checksummed), then an end entry with sizes 0 and the CRC32C of
+  // the whole closes it.
+  //
+  // Raw sizes sum to the original length and none is 0. A block whose
+  // coded size equals its raw size holds the raw bytes as they are; the
+  // encoder stores any block that its codec does not shrink. Blocks
+  // share nothing but the codec parameters, so each one decodes on its
+  // own: in parallel, or just the ones a caller needs.
+  constexpr char          kContainerMagic[4]  = {'C', 'M', 'P', 'R'};
+  constexpr std::uint8_t  kContainerVersion   = 2;
+  constexpr std::uint32_t kContainerMaxParams = 4096;
+  // Longest header ahead of the codec parameters: magic, two bytes and
+  // varints of at most 64, 32 and 13 bits
+  constexpr std::size_t   kContainerMaxHeaderSize = 4 + 2 + 10 + 5 + 2;
+
+  // Flags: CRC32C (see Crc32c.hpp) of every block and of the whole data.
+  // compressFile always sets it; a decoder checks each block it decodes
+  // and, when it decodes them all, the whole.
+  constexpr std::uint8_t kContainerChecksums  = 0x01;
+  // Flags: a streamed container (above), as CompressStream writes
+  constexpr std::uint8_t kContainerStreamed   = 0x02;
+  // Flags: a block size and per-block table entries; set for more than
+  // one block and always when streamed
+  constexpr std::uint8_t kContainerBlocks     = 0x04;
+  // Flags: codec parameters follow the header
+  constexpr std::uint8_t kContainerParams     = 0x08;
+
+  // Streamed entry bytes for 'flags'
+  constexpr std::size_t containerEntrySize(std::uint8_t flags) {
+    return (flags & kContainerChecksums) ? 4 + 4 + 4 : 4 + 4;
+  }
+
+  // decodeBlock may write this many bytes past the end of a block
+  constexpr std::size_t kBlockSlack = 64;
+
+  /**
+   * Codec side of a container: turns one block into a payload and back.
+   * Calls for different blocks run concurrently, each with the scratch
+   * arena of the worker thread running it, rolled back after the block.
+   */
+  class BlockCodec {
+  public:
+    virtual ~BlockCodec() = default;
+
+    // Raw bytes per block when encoding
+    virtual std::uint32_t blockSize() const = 0;
+
+    // Scratch one worker needs to encode or decode a block of n bytes,
+    // including the coded output
+    virtual std::size_t scratchBytes(std::size_t n) const = 0;
+
+    // Codec parameters for the header; none unless overridden
+    virtual void writeParams(std::pmr::vector<std::uint8_t>& out) const {
+      (void)out;
+    }
+
+    // Check parameters read from a header before any block is decoded
+    virtual bool readParams(const std::uint8_t* params, std::size_t size) {
+      (void)params;
+      return size == 0;
+    }
+
+    // Code in[0..n) into 'out' (empty, memory from 'scratch'); false if
+    // the block cannot be coded, which stores it instead
+    virtual bool encodeBlock(const std::uint8_t* in,
+                             std::size_t n,
+                             Arena& scratch,
+                             std::pmr::vector<std::uint8_t>& out) const = 0;
+
+    // Decode the payload [in, in + size) into exactly n bytes at 'out',
+    // which has kBlockSlack writable bytes past n
+    virtual bool decodeBlock(const std::uint8_t* in,
+                             std::size_t size,
+                             std::uint8_t* out,
+                             std::size_t n,
+                             Arena& scratch) const = 0;
+  };
+
+  struct ContainerInfo {
+    Algorithm     codec       = Algorithm::HUFFMAN;
+    std::uint8_t  level       = 0;
+    std::uint8_t  flags       = 0;
+    std::uint32_t blockSize   = 0; // the length for a single block
+    std::uint64_t length      = 0; // original bytes
+    std::uint32_t count       = 0; // blocks
+    std::uint32_t paramsSize  = 0;
+    std::uint32_t crc         = 0; // CRC32C of the original data, if checksummed
+  };
+
+  struct ContainerBlock {
+    std::uint64_t rawOffset = 0; // position in the original data
+    std::uint32_t rawSize   = 0;
+    std::uint64_t offset    = 0; // position of the block in the file
+    std::uint32_t size      = 0; // coded bytes; == rawSize when stored
+    std::uint32_t crc       = 0; // CRC32C of the raw bytes, if checksummed
+  };
+
+  // True if the first n bytes of a file start a container
+  bool isContainer(const std::uint8_t* head, std::size_t n);
+
+  // Read and validate just the header from the first n bytes of a
+  // container (info.crc stays 0, and count too if streamed); false if it
+  // is not one this version can decode or n bytes do not hold all of it.
+  // The codec parameters follow at containerHeaderSize(info).
+  bool readContainerHeader(const std::uint8_t* head, std::size_t n,
+                           ContainerInfo& info);
+
+  // Header bytes ahead of the codec parameters for 'info', at most
+  // kContainerMaxHeaderSize
+  std::size_t containerHeaderSize(const ContainerInfo& info);
+
+  // Header and codec parameters (containerHeaderSize(info) +
+  // info.paramsSize bytes) for 'info'. The kContainerBlocks and
+  // kContainerParams flags follow from the count and parameters, so
+  // info.flags need not have them.
+  void writeContainerHeader(std::uint8_t* out, const ContainerInfo& info,
+                            const std::uint8_t* params);
+
+  // Streamed entry (containerEntrySize(flags) bytes), and back; the
+  // checksum only with kContainerChecksums
+  void writeContainerEntry(std::uint8_t* out, std::uint8_t flags,
+                           std::uint32_t size, std::uint32_t rawSize,
+                           std::uint32_t crc);
+  void readContainerEntry(const std::uint8_t* in, std::uint8_t flags,
+                          ContainerBlock& b);
+
+  // Read and validate the header, codec parameters and block table at
+  // the start of src (fileSize bytes long); false if it is not a
+  // container this version can decode. Memory comes from 'memory'.
+  bool readContainer(std::istream& src,
+                     std::uint64_t fileSize,
+                     ContainerInfo& info,
+                     std::pmr::vector<std::uint8_t>& params,
+                     std::pmr::vector<ContainerBlock>& blocks,
+                     std::pmr::memory_resource* memory);
+
+  // Same, for a whole container of 'size' bytes in memory
+  bool readContainer(const std::uint8_t* data,
+                     std::size_t size,
+                     ContainerInfo& info,
+                     std::pmr::vector<std::uint8_t>& params,
+                     std::pmr::vector<ContainerBlock>& blocks);
+
+  // Context memory to compress or decompress inputs of up to inputBytes
+  // with 'codec' on 'workers' threads
+  Workspace containerWorkspace(const BlockCodec& codec,
+                               std::uint64_t inputBytes,
+                               unsigned workers);
+
+  // Largest container 'codec' writes for n bytes: header, parameters and
+  // table plus n, as every block is stored if it does not shrink. 0 if
+  // no container can hold n bytes.
+  std::size_t containerBound(const BlockCodec& codec, std::size_t n);
+
+  // Compress inPath into a container at outPath, 'codec' coding the
+  // blocks. Blocks are read and coded one batch per thread at a time, so
+  // memory stays at a few blocks per thread whatever the file size.
+  Result containerCompressFile(const std::string& inPath,
+                               const std::string& outPath,
+                               Algorithm algo,
+                               int level,
+                               const BlockCodec& codec,
+                               std::uint32_t threads,
+                               Context& ctx);
+
+  // Compress in[0..n) into a container at out[0..cap), the same bytes
+  // containerCompressFile writes for the same data. Blocks are coded
+  // straight from 'in' and each payload copied once into 'out'; nothing
+  // else is buffered. Fails with -2 if 'out' is too small (never with
+  // cap >= containerBound). 'in' and 'out' must not overlap.
+  Result containerCompressBuffer(const std::uint8_t* in,
+                                 std::size_t n,
+                                 std::uint8_t* out,
+                                 std::size_t cap,
+                                 Algorithm algo,
+                                 int level,
+                                 const BlockCodec& codec,
+                                 std::uint32_t threads,
+                                 Context& ctx);
+
+  // Decode the container at inPath into outPath; 'codec' must match the
+  // codec named in its header. Block buffers are sized once from the
+  // block table. Fails with -4 if a checksum does not match.
+  Result containerDecompressFile(const std::string& inPath,
+                                 const std::string& outPath,
+                                 BlockCodec& codec,
+                                 std::uint32_t threads,
+                                 Context& ctx);
+
+  // Length that reaches the end of the data wherever the range starts
+  constexpr std::uint64_t kContainerToEnd = ~std::uint64_t{0};
+
+  // Write original bytes [offset, offset + length) of the container at
+  // inPath to outPath, clipped to the data (an offset past the end gives
+  // an empty file). Only the blocks overlapping the range are read and
+  // decoded, and only their checksums checked. bytesIn counts the
+  // container bytes read, bytesOut the bytes written.
+  Result containerDecompressRange(const std::string& inPath,
+                                  const std::string& outPath,
+                                  std::uint64_t offset,
+                                  std::uint64_t length,
+                                  BlockCodec& codec,
+                                  std::uint32_t threads,
+                                  Context& ctx);
+
+  // Decode the container in[0..n) into out[0..cap); fails with -2 if the
+  // original length does not fit. Blocks decode straight into 'out'. Only
+  // a block without kBlockSlack bytes after it before cap goes through
+  // scratch; bytes of 'out' between the length and cap may be clobbered.
+  Result containerDecompressBuffer(const std::uint8_t* in,
+                                   std::size_t n,
+                                   std::uint8_t* out,
+                                   std::size_t cap,
+                                   BlockCodec& codec,
+                                   std::uint32_t threads,
+                                   Context& ctx);
+
+} // namespace CompressionLib
+
+#endif
@@ -0,0 +1,54 @@
+#include "compress/Lib/CompressionLib/Context.hpp"
+
+namespace CompressionLib {
+
+Context::Context(std::uint32_t threads)
+  : m_workers(workerCount(threads))
+  , m_scratch(new Arena[m_workers])
+  , m_pool(m_workers)
+{
+}
+
+Context::Context(Algorithm algo, int level, std::uint64_t maxInputBytes,
+                 std::uint32_t threads)
+  : Context(threads)
+{
+  reserve(compressionWorkspace(algo, level, maxInputBytes, m_workers));
+}
+
+void Context::reserve(const Workspace& w) {
+  m_job.reserve(w.jobBytes);
+  for (unsigned i = 0; i < m_workers; ++i) {
+    m_scratch[i].reserve(w.scratchBytes);
+  }
+}
+
+void Context::reset() {
+  m_job.reset();
+  for (unsigned i = 0; i < m_workers; ++i) {
+    m_scratch[i].reset();
+  }
+}
+
+unsigned Context::workersFor(std::uint32_t requested) const {
+  const unsigned n = workerCount(requested);
+  return (n < m_workers) ? n : m_workers;
+}
+
+std::size_t Context::capacity() const {
+  std::size_t total = m_job.capacity();
+  for (unsigned i = 0; i < m_workers; ++i) {
+    total += m_scratch[i].capacity();
+  }
+  return total;
+}
+
+std::size_t Context::highWater() const {
+  std::size_t total = m_job.highWater();
+  for (unsigned i = 0; i < m_workers; ++i) {
+    total += m_scratch[i].highWater();
+  }
+  return total;
+}
+
+} // namespace CompressionLib
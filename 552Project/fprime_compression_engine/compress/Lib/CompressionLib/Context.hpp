@@ -0,0 +1,87 @@
+#ifndef COMPRESSION_LIB_CONTEXT_HPP
+#define COMPRESSION_LIB_CONTEXT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "compress/Lib/CompressionLib/Arena.hpp"
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Parallel.hpp"
+
+namespace CompressionLib {
+
+  // Working memory a job needs, split the way Context holds it
+  struct Workspace {
+    // Buffers that live for the whole job: file contents, coded blocks
+    std::size_t jobBytes = 0;
+    // Per worker thread: match finders, windows, block scratch
+    std::size_t scratchBytes = 0;
+  };
+
+  /**
+   * Working memory for compression jobs, reused from one job to the next.
+   *
+   * Codecs take every buffer they need from the context's arenas: one
+   * shared by the whole job and one scratch arena per worker thread, which
+   * a worker rolls back after each block so scratch stays bounded by the
+   * thread count rather than the input size. Each job starts by resetting
+   * the arenas, so a context sized for its workload does no heap
+   * allocation after construction. An undersized context still works; the
+   * overflow goes to the heap once and the arenas grow to fit the next
+   * job. Worker threads are likewise started by the first job that needs
+   * them and kept for every job after it. Only file streams use the heap
+   * after that, plus the DCT codec, whose image library allocates on its
+   * own.
+   *
+   * A context runs one job at a time and caps the worker threads of every
+   * job run on it.
+   */
+  class Context {
+  public:
+    // Empty arenas for up to 'threads' workers (0 = one per hardware
+    // thread); they grow to fit the first job
+    explicit Context(std::uint32_t threads = 0);
+
+    // Arenas sized for compressing or decompressing inputs of up to
+    // maxInputBytes with 'algo' at 'level' (see compressionWorkspace)
+    Context(Algorithm algo, int level, std::uint64_t maxInputBytes,
+            std::uint32_t threads = 0);
+
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    // Grow the arenas to hold at least 'w'
+    void reserve(const Workspace& w);
+
+    // Drop everything allocated; codecs call this as a job starts
+    void reset();
+
+    unsigned workers() const { return m_workers; }
+    // Threads for a job asking for 'requested' (0 = one per hardware
+    // thread), capped at workers()
+    unsigned workersFor(std::uint32_t requested) const;
+    Arena& job() { return m_job; }
+    Arena& scratch(unsigned worker) { return m_scratch[worker]; }
+    WorkerPool& pool() { return m_pool; }
+
+    // Bytes reserved, and the most used at once, over all arenas
+    std::size_t capacity() const;
+    std::size_t highWater() const;
+
+  private:
+    unsigned m_workers;
+    Arena m_job;
+    std::unique_ptr<Arena[]> m_scratch;
+    WorkerPool m_pool;
+  };
+
+  // Memory a Context needs to run 'algo' at 'level' on inputs of up to
+  // maxInputBytes, in either direction, on 'threads' workers (0 = one per
+  // hardware thread)
+  Workspace compressionWorkspace(Algorithm algo, int level,
+                                 std::uint64_t maxInputBytes,
+                                 std::uint32_t threads = 0);
+
+} // namespace CompressionLib
+
+#endif
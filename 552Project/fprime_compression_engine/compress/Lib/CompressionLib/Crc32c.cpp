@@ -0,0 +1,176 @@
+#include "compress/Lib/CompressionLib/Crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define COMPRESSION_LIB_CRC32C_HW 1
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#define CRC32C_U64(c, v) static_cast<std::uint32_t>(_mm_crc32_u64((c), (v)))
+#define CRC32C_U8(c, v) _mm_crc32_u8((c), (v))
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32) && !defined(__AARCH64EB__)
+#include <arm_acle.h>
+#define COMPRESSION_LIB_CRC32C_HW 1
+#define CRC32C_TARGET
+#define CRC32C_U64(c, v) __crc32cd((c), (v))
+#define CRC32C_U8(c, v) __crc32cb((c), (v))
+#endif
+
+namespace CompressionLib {
+
+namespace {
+
+// Bit-reflected Castagnoli polynomial. In this representation bit 31 is
+// the coefficient of x^0 and bit 0 that of x^31.
+constexpr std::uint32_t kPoly = 0x82F63B78u;
+
+// ---------- Arithmetic mod P (for combining) ----------
+
+// a * b mod P
+constexpr std::uint32_t multModP(std::uint32_t a, std::uint32_t b) {
+  std::uint32_t product = 0;
+  for (std::uint32_t m = 0x80000000u; m != 0; m >>= 1) {
+    if (a & m) {
+      product ^= b;
+    }
+    b = (b & 1u) ? (b >> 1) ^ kPoly : b >> 1;
+  }
+  return product;
+}
+
+// x^(8n) mod P: multiplying a CRC register by it appends n zero bytes
+constexpr std::uint32_t xPow8n(std::uint64_t n) {
+  std::uint32_t result = 0x80000000u; // x^0
+  std::uint32_t square = 0x00800000u; // x^8
+  while (n != 0) {
+    if (n & 1u) {
+      result = multModP(square, result);
+    }
+    square = multModP(square, square);
+    n >>= 1;
+  }
+  return result;
+}
+
+// ---------- Slicing-by-8 ----------
+
+using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+// Table k advances a byte through k further zero bytes
+constexpr Tables makeTables() {
+  Tables t{};
+  for (std::uint32_t b = 0; b < 256; ++b) {
+    std::uint32_t c = b;
+    for (int bit = 0; bit < 8; ++bit) {
+      c = (c & 1u) ? (c >> 1) ^ kPoly : c >> 1;
+    }
+    t[0][b] = c;
+  }
+  for (std::size_t k = 1; k < 8; ++k) {
+    for (std::size_t b = 0; b < 256; ++b) {
+      t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFFu];
+    }
+  }
+  return t;
+}
+
+constexpr Tables kTables = makeTables();
+
+std::uint32_t getLe32(const std::uint8_t* p) {
+  return static_cast<std::uint32_t>(p[0]) |
+         (static_cast<std::uint32_t>(p[1]) << 8) |
+         (static_cast<std::uint32_t>(p[2]) << 16) |
+         (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+// Raw register update (no pre/post inversion), eight bytes per step
+std::uint32_t crcTables(std::uint32_t c, const std::uint8_t* p, std::size_t n) {
+  const Tables& t = kTables;
+  while (n >= 8) {
+    const std::uint32_t lo = c ^ getLe32(p);
+    const std::uint32_t hi = getLe32(p + 4);
+    c = t[7][lo & 0xFFu] ^ t[6][(lo >> 8) & 0xFFu] ^
+        t[5][(lo >> 16) & 0xFFu] ^ t[4][lo >> 24] ^
+        t[3][hi & 0xFFu] ^ t[2][(hi >> 8) & 0xFFu] ^
+        t[1][(hi >> 16) & 0xFFu] ^ t[0][hi >> 24];
+    p += 8;
+    n -= 8;
+  }
+  while (n-- > 0) {
+    c = (c >> 8) ^ t[0][(c ^ *p++) & 0xFFu];
+  }
+  return c;
+}
+
+// ---------- crc32 instruction ----------
+
+#if defined(COMPRESSION_LIB_CRC32C_HW)
+
+// One crc32 has a 3-cycle latency but issues every cycle, so three
+// interleaved lanes are joined by shifting the first two past the rest
+constexpr std::size_t kLane = 4096;
+constexpr std::uint32_t kShift1 = xPow8n(kLane);
+constexpr std::uint32_t kShift2 = xPow8n(2 * kLane);
+
+std::uint64_t load64(const std::uint8_t* p) {
+  std::uint64_t v = 0;
+  std::memcpy(&v, p, 8);
+  return v;
+}
+
+CRC32C_TARGET
+std::uint32_t crcHardware(std::uint32_t c, const std::uint8_t* p, std::size_t n) {
+  while (n >= 3 * kLane) {
+    std::uint32_t a = c;
+    std::uint32_t b = 0;
+    std::uint32_t d = 0;
+    for (std::size_t i = 0; i < kLane; i += 8) {
+      a = CRC32C_U64(a, load64(p + i));
+      b = CRC32C_U64(b, load64(p + kLane + i));
+      d = CRC32C_U64(d, load64(p + 2 * kLane + i));
+    }
+    c = multModP(kShift2, a) ^ multModP(kShift1, b) ^ d;
+    p += 3 * kLane;
+    n -= 3 * kLane;
+  }
+  while (n >= 8) {
+    c = CRC32C_U64(c, load64(p));
+    p += 8;
+    n -= 8;
+  }
+  while (n-- > 0) {
+    c = CRC32C_U8(c, *p++);
+  }
+  return c;
+}
+
+#endif
+
+using CrcFn = std::uint32_t (*)(std::uint32_t, const std::uint8_t*, std::size_t);
+
+CrcFn selectCrc() {
+#if defined(COMPRESSION_LIB_CRC32C_HW) && defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    return crcHardware;
+  }
+#elif defined(COMPRESSION_LIB_CRC32C_HW)
+  return crcHardware;
+#endif
+  return crcTables;
+}
+
+} // namespace
+
+std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t n) {
+  static const CrcFn fn = selectCrc();
+  return ~fn(~crc, static_cast<const std::uint8_t*>(data), n);
+}
+
+std::uint32_t crc32cCombine(std::uint32_t crcA,
+                            std::uint32_t crcB,
+                            std::uint64_t lengthB) {
+  return multModP(xPow8n(lengthB), crcA) ^ crcB;
+}
+
+} // namespace CompressionLib
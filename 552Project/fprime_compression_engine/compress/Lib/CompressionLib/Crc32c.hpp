@@ -0,0 +1,30 @@
+#ifndef COMPRESSION_LIB_CRC32C_HPP
+#define COMPRESSION_LIB_CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CompressionLib {
+
+  /**
+   * CRC-32C (Castagnoli polynomial, as used by iSCSI, ext4 and the SSE4.2
+   * crc32 instruction). crc32c(0, data, n) is the checksum of data[0..n);
+   * passing an earlier result as 'crc' continues it over more data.
+   *
+   * Uses the crc32 instruction on x86-64 CPUs with SSE4.2 (checked at
+   * run time) and on ARMv8 when built with the CRC extension (e.g.
+   * -march=armv8-a+crc), otherwise slicing-by-8 tables. Both run at
+   * several GB/s, far faster than any codec here.
+   */
+  std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t n);
+
+  // Checksum of A followed by B, from crcA = crc32c(0, A), crcB =
+  // crc32c(0, B) and B's length. Lets blocks be checksummed separately,
+  // on different threads, and still give the checksum of the whole.
+  std::uint32_t crc32cCombine(std::uint32_t crcA,
+                              std::uint32_t crcB,
+                              std::uint64_t lengthB);
+
+} // namespace CompressionLib
+
+#endif
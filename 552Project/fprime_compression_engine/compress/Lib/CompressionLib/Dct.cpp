@@ -1,4 +1,5 @@
 #include "compress/Lib/CompressionLib/Dct.hpp"
+#include "compress/Lib/CompressionLib/Codecs.hpp"
 #include <cstdint>
 #include <vector>
 #include <fstream>
@@ -94,7 +95,7 @@ std::string makeJpegOutPath(const std::string& inPath) {
 // "DCT" Compressor → JPEG
 // ======================
 
-Result dctCompressFile(const std::string& inPath) {
+Result dctCompressFile(const std::string& inPath, int quality) {
   Result r{};
   r.error    = 0;
   r.bytesIn  = 0;
@@ -142,7 +143,8 @@ Result dctCompressFile(const std::string& inPath) {
 
   // 2) Encode as JPEG (lossy, DCT-based) with chosen quality
   // Quality in [1,100]; 75–90 is a good tradeoff
-  const int quality = 85;
+  if (quality < 1) quality = 1;
+  if (quality > 100) quality = 100;
 
   int ok = stbi_write_jpg(
       outPath.c_str(),
@@ -167,6 +169,15 @@ Result dctCompressFile(const std::string& inPath) {
   return r;
 }
 
+int dctQualityForLevel(int level) {
+  static const int kQualities[kMaxLevel] = {
+    98, 96, 94, 92, 90, 85, 80, 75, 65, 55, 45, 35
+  };
+  if (level < kMinLevel) level = kMinLevel;
+  if (level > kMaxLevel) level = kMaxLevel;
+  return kQualities[level - 1];
+}
+
 // ======================
 // Decompressor stub
 // (not really needed for JPEG; viewing the file is decompression)
@@ -180,4 +191,39 @@ Result dctDecompressFile(const std::string& inPath) {
   return r;
 }
 
+// -------------------- Codec registration --------------------
+
+namespace {
+
+// Lossy and image-only: writes a JPEG of its own rather than a container,
+// so it has no blocks, streams or ranges, and its memory grows with the
+// image
+class DctCodec final : public Codec {
+public:
+  Algorithm algorithm() const override { return Algorithm::DCT; }
+  const char* name() const override { return "DCT"; }
+  const char* extension() const override { return ".jpg"; }
+  CodecCapabilities capabilities() const override {
+    CodecCapabilities caps;
+    caps.lossy = true;
+    return caps;
+  }
+
+  Result compressFile(const std::string& path, int level) const override {
+    return dctCompressFile(path, dctQualityForLevel(level));
+  }
+
+  Result decompressFile(const std::string& path,
+                        Context* context) const override {
+    (void)context;
+    return dctDecompressFile(path);
+  }
+};
+
+const DctCodec kDctCodec;
+
+} // namespace
+
+const CodecRegistration dctCodecRegistration(kDctCodec);
+
 } // namespace CompressionLib
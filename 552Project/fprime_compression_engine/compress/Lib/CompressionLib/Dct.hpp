@@ -29,8 +29,20 @@ namespace CompressionLib {
    *              -2: invalid PPM file when extension is .ppm
    *              -3: could not open output file
    *              -7: stb_image failed to decode non-PPM input
+   *
+   * quality is the JPEG quality, clamped to [1, 100].
+   */
+  constexpr int kDctDefaultQuality = 85;
+
+  Result dctCompressFile(const std::string& inPath,
+                         int quality = kDctDefaultQuality);
+
+  /**
+   * JPEG quality for a compression level (see CompressionLib.hpp). Higher
+   * levels trade image fidelity for fewer bytes: 1 = 98, 6 = 85 (the
+   * default), 12 = 35. Out-of-range levels are clamped.
    */
-  Result dctCompressFile(const std::string& inPath);
+  int dctQualityForLevel(int level);
 
   /**
    * DCT-based decompressor.
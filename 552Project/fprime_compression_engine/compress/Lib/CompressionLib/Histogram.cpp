@@ -0,0 +1,69 @@
+#include "compress/Lib/CompressionLib/Histogram.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace CompressionLib {
+
+namespace {
+
+// Sub-table counters are 32-bit, so count at most this much per pass
+constexpr std::size_t kMaxPass = std::size_t(1) << 30;
+
+// Add the histogram of data[0..size) (size <= kMaxPass) to counts
+void countPass(const std::uint8_t* data, std::size_t size, std::uint64_t* counts) {
+  std::uint32_t c0[256] = {};
+  std::uint32_t c1[256] = {};
+  std::uint32_t c2[256] = {};
+  std::uint32_t c3[256] = {};
+
+  const std::uint8_t* ip = data;
+  const std::uint8_t* const end = data + size;
+  while (end - ip >= 16) {
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+    std::memcpy(&a, ip, 8);
+    std::memcpy(&b, ip + 8, 8);
+    ip += 16;
+    // Byte order does not matter: every byte is counted once
+    for (int k = 0; k < 2; ++k) {
+      ++c0[a & 0xFFu];
+      ++c1[(a >> 8) & 0xFFu];
+      ++c2[(a >> 16) & 0xFFu];
+      ++c3[(a >> 24) & 0xFFu];
+      ++c0[b & 0xFFu];
+      ++c1[(b >> 8) & 0xFFu];
+      ++c2[(b >> 16) & 0xFFu];
+      ++c3[(b >> 24) & 0xFFu];
+      a >>= 32;
+      b >>= 32;
+    }
+  }
+  while (ip < end) {
+    ++c0[*ip++];
+  }
+
+  for (std::size_t s = 0; s < 256; ++s) {
+    counts[s] += static_cast<std::uint64_t>(c0[s]) + c1[s] + c2[s] + c3[s];
+  }
+}
+
+void countInto(const std::uint8_t* data, std::size_t size, std::uint64_t* counts) {
+  while (size > 0) {
+    const std::size_t n = std::min(size, kMaxPass);
+    countPass(data, n, counts);
+    data += n;
+    size -= n;
+  }
+}
+
+} // namespace
+
+void histogramCount(const std::uint8_t* data,
+                    std::size_t size,
+                    std::uint64_t* counts) {
+  std::fill(counts, counts + 256, static_cast<std::uint64_t>(0));
+  countInto(data, size, counts);
+}
+
+} // namespace CompressionLib
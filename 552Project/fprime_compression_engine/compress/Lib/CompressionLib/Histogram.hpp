@@ -0,0 +1,23 @@
+#ifndef COMPRESSION_LIB_HISTOGRAM_HPP
+#define COMPRESSION_LIB_HISTOGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace CompressionLib {
+
+  /**
+   * Byte histogram: counts[b] = occurrences of b in data[0..size).
+   * counts has 256 entries and is overwritten.
+   *
+   * Counting into one table stalls on runs of equal bytes, since each
+   * increment waits for the previous store to the same slot. This spreads
+   * consecutive bytes over four sub-tables and sums them at the end.
+   */
+  void histogramCount(const std::uint8_t* data,
+                      std::size_t size,
+                      std::uint64_t* counts);
+
+} // namespace CompressionLib
+
+#endif
@@ -1,11 +1,15 @@
 #include "compress/Lib/CompressionLib/Huffman.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
-#include <queue>
+#include <new>
 #include <vector>
 #include <array>
-#include <memory>
+#include <optional>
+
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/Histogram.hpp"
 
 namespace CompressionLib {
 
@@ -13,201 +17,372 @@ namespace {
 
 // ---------- Helpers for endian-safe header I/O ----------
 
-void writeUint32(std::ofstream& os, std::uint32_t v) {
-  std::uint8_t b[4];
-  b[0] = static_cast<std::uint8_t>(v & 0xFFu);
-  b[1] = static_cast<std::uint8_t>((v >> 8) & 0xFFu);
-  b[2] = static_cast<std::uint8_t>((v >> 16) & 0xFFu);
-  b[3] = static_cast<std::uint8_t>((v >> 24) & 0xFFu);
-  os.write(reinterpret_cast<const char*>(b), 4);
+std::uint64_t getLe(const std::uint8_t* p, std::size_t bytes) {
+  std::uint64_t v = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+  }
+  return v;
 }
 
-std::uint32_t readUint32(std::ifstream& is, bool& ok) {
-  std::uint8_t b[4];
-  if (!is.read(reinterpret_cast<char*>(b), 4)) {
-    ok = false;
-    return 0;
-  }
-  ok = true;
-  return static_cast<std::uint32_t>(b[0]) |
-         (static_cast<std::uint32_t>(b[1]) << 8) |
-         (static_cast<std::uint32_t>(b[2]) << 16) |
-         (static_cast<std::uint32_t>(b[3]) << 24);
+void putLe(std::uint8_t* p, std::uint64_t v, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+  }
 }
 
-void writeUint16(std::ofstream& os, std::uint16_t v) {
-  std::uint8_t b[2];
-  b[0] = static_cast<std::uint8_t>(v & 0xFFu);
-  b[1] = static_cast<std::uint8_t>((v >> 8) & 0xFFu);
-  os.write(reinterpret_cast<const char*>(b), 2);
+// ---------- Encoder ----------
+
+// Encode data[0..size), flushing the accumulator once per kPerFlush
+// symbols (kPerFlush * maxLength + 7 must fit in 64 bits)
+template <std::uint32_t kPerFlush>
+void encodeSymbols(const HuffmanEncoder& enc,
+                   HuffmanBitWriter& bw,
+                   const std::uint8_t* ip,
+                   std::size_t size) {
+  const std::uint8_t* const end = ip + size;
+  while (static_cast<std::size_t>(end - ip) >= kPerFlush) {
+    for (std::uint32_t k = 0; k < kPerFlush; ++k) {
+      enc.encode(bw, *ip++);
+    }
+    bw.flush();
+  }
+  while (ip < end) {
+    enc.encode(bw, *ip++);
+    bw.flush();
+  }
 }
 
-std::uint16_t readUint16(std::ifstream& is, bool& ok) {
-  std::uint8_t b[2];
-  if (!is.read(reinterpret_cast<char*>(b), 2)) {
-    ok = false;
-    return 0;
+// One bitstream for ip[0..size) at dst; returns its length in bytes.
+// dst needs room for the encoded bytes plus 8 bytes of slack.
+std::size_t encodeStream(const HuffmanEncoder& enc,
+                         const std::uint8_t* ip,
+                         std::size_t size,
+                         std::uint8_t* dst) {
+  HuffmanBitWriter bw(dst);
+  if (enc.maxLength() <= 11) {
+    encodeSymbols<5>(enc, bw, ip, size);
+  } else if (enc.maxLength() <= 14) {
+    encodeSymbols<4>(enc, bw, ip, size);
+  } else {
+    encodeSymbols<3>(enc, bw, ip, size);
   }
-  ok = true;
-  return static_cast<std::uint16_t>(b[0]) |
-         (static_cast<std::uint16_t>(b[1]) << 8);
+  return bw.finish();
 }
 
-// ---------- Huffman structures ----------
+// ---------- Four-stream layout ----------
+
+constexpr std::size_t kStreams = 4;
+constexpr std::size_t kJumpTableSize = 4 * (kStreams - 1);
+// Below this the jump table costs more than the faster decode is worth
+constexpr std::size_t kMinFourStreamSize = 1024;
+
+// Streams 0..2 hold this many symbols each, stream 3 the rest
+std::size_t segmentSize(std::uint64_t size) {
+  return static_cast<std::size_t>((size + kStreams - 1) / kStreams);
+}
+
+// Jump table (u32 size of streams 0..2), then the four streams.
+// dst needs room for the table, the encoded bytes plus one per stream,
+// and 8 bytes of slack. Returns bytes written.
+std::size_t encodeStreams4(const HuffmanEncoder& enc,
+                           const std::uint8_t* ip,
+                           std::size_t size,
+                           std::uint8_t* dst) {
+  const std::size_t seg = segmentSize(size);
+  std::uint8_t* op = dst + kJumpTableSize;
+  for (std::size_t i = 0; i < kStreams; ++i) {
+    const std::size_t n = (i + 1 < kStreams) ? seg : size - 3 * seg;
+    const std::size_t bytes = encodeStream(enc, ip + i * seg, n, op);
+    if (i + 1 < kStreams) {
+      putLe(dst + 4 * i, bytes, 4);
+    }
+    op += bytes;
+  }
+  return static_cast<std::size_t>(op - dst);
+}
+
+// ---------- HUF1 tree ----------
+
+constexpr std::int16_t kNoNode = -1;
 
 struct HuffNode {
   std::uint8_t symbol;
   std::uint64_t freq;
-  HuffNode* left;
-  HuffNode* right;
-  bool isLeaf() const { return left == nullptr && right == nullptr; }
+  std::int16_t left;
+  std::int16_t right;
+  bool isLeaf() const { return left == kNoNode && right == kNoNode; }
 };
 
-struct NodePtrCompare {
-  bool operator()(const HuffNode* a, const HuffNode* b) const {
-    return a->freq > b->freq; // min-heap
-  }
+// Up to 256 leaves and 255 internal nodes, on the stack
+struct HuffTree {
+  HuffNode nodes[511];
+  std::int16_t root = kNoNode;
 };
 
-// Build Huffman tree from frequency table.
-// freqs[sym] = frequency, sym 0..255.
-HuffNode* buildTree(const std::array<std::uint64_t,256>& freqs) {
-  std::priority_queue<HuffNode*, std::vector<HuffNode*>, NodePtrCompare> pq;
+// Build the Huffman tree HUF1 files were coded with from their frequency
+// table (freqs[sym], sym 0..255). The heap is driven with the same
+// push_heap / pop_heap sequence std::priority_queue uses, so ties break
+// exactly as in the original encoder.
+void buildTree(const std::array<std::uint64_t,256>& freqs, HuffTree& tree) {
+  std::int16_t heap[256];
+  std::size_t heapSize = 0;
+  std::size_t nodeCount = 0;
+  auto greater = [&](std::int16_t a, std::int16_t b) {
+    return tree.nodes[a].freq > tree.nodes[b].freq; // min-heap
+  };
 
   for (std::size_t i = 0; i < 256; ++i) {
     if (freqs[i] > 0) {
-      auto* node = new HuffNode{
+      tree.nodes[nodeCount] = HuffNode{
         static_cast<std::uint8_t>(i),
         freqs[i],
-        nullptr,
-        nullptr
+        kNoNode,
+        kNoNode
       };
-      pq.push(node);
+      heap[heapSize++] = static_cast<std::int16_t>(nodeCount++);
+      std::push_heap(heap, heap + heapSize, greater);
     }
   }
 
   // Edge case: file of length 0 → no tree
-  if (pq.empty()) {
-    return nullptr;
-  }
-
-  // Edge case: only one symbol → single-node tree
-  if (pq.size() == 1) {
-    auto* only = pq.top(); pq.pop();
-    // We can just return it; encoding will be 0 bits repeatedly
-    return only;
+  if (heapSize == 0) {
+    tree.root = kNoNode;
+    return;
   }
 
-  while (pq.size() > 1) {
-    HuffNode* a = pq.top(); pq.pop();
-    HuffNode* b = pq.top(); pq.pop();
+  // With only one symbol the leaf is the root: 0 bits per symbol
+  while (heapSize > 1) {
+    std::pop_heap(heap, heap + heapSize, greater);
+    const std::int16_t a = heap[--heapSize];
+    std::pop_heap(heap, heap + heapSize, greater);
+    const std::int16_t b = heap[--heapSize];
 
-    auto* parent = new HuffNode{
+    tree.nodes[nodeCount] = HuffNode{
       0,               // symbol unused for internal nodes
-      a->freq + b->freq,
+      tree.nodes[a].freq + tree.nodes[b].freq,
       a,
       b
     };
-    pq.push(parent);
+    heap[heapSize++] = static_cast<std::int16_t>(nodeCount++);
+    std::push_heap(heap, heap + heapSize, greater);
   }
 
-  return pq.top();
+  tree.root = heap[0];
 }
 
-void freeTree(HuffNode* node) {
-  if (!node) return;
-  freeTree(node->left);
-  freeTree(node->right);
-  delete node;
-}
+// ---------- HUF1 bit reader ----------
+
+// MSB-first bit reader over an in-memory buffer
+struct BitReader {
+  const std::uint8_t* ip;
+  const std::uint8_t* iend;
+  std::uint8_t current = 0;
+  int bitsLeft = 0;
 
-// Recursively build codes: symbol -> bitstring (as vector<bool>)
-void buildCodeTable(HuffNode* node,
-                    std::vector<bool>& prefix,
-                    std::array<std::vector<bool>,256>& table) {
-  if (!node) return;
+  BitReader(const std::uint8_t* begin, const std::uint8_t* end)
+    : ip(begin), iend(end) {}
 
-  if (node->isLeaf()) {
-    // Edge case: single symbol, prefix can be empty; assign '0' at least
-    if (prefix.empty()) {
-      prefix.push_back(false);
+  // Returns (ok, bit). ok=false if we hit the end of input.
+  std::pair<bool, bool> readBit() {
+    if (bitsLeft == 0) {
+      if (ip >= iend) {
+        return {false, false};
+      }
+      current = *ip++;
+      bitsLeft = 8;
     }
-    table[node->symbol] = prefix;
-    return;
+    bool bit = (current & 0x80u) != 0;
+    current <<= 1;
+    --bitsLeft;
+    return {true, bit};
   }
+};
+
+// ---------- Decoders ----------
 
-  // Left = 0
-  prefix.push_back(false);
-  buildCodeTable(node->left, prefix, table);
-  prefix.pop_back();
+constexpr std::size_t kMagicSize = 4;
+// A code-length table: mode byte, varint n, at most 128 bytes of packed
+// lengths
+constexpr std::size_t kMaxTableSize = 1 + 2 + 128;
 
-  // Right = 1
-  prefix.push_back(true);
-  buildCodeTable(node->right, prefix, table);
-  prefix.pop_back();
+bool isHuf1(const std::uint8_t* magic) {
+  return magic[0] == 'H' && magic[1] == 'U' && magic[2] == 'F' &&
+         magic[3] == '1';
 }
 
-// ---------- Bit writer / reader ----------
+// HUF1: u32 size, u16 symbol count, (u8 symbol, u32 freq) per symbol,
+// then codes from the frequency-built tree
+bool decodeHuf1(const std::uint8_t* ip,
+                const std::uint8_t* iend,
+                std::pmr::vector<std::uint8_t>& output) {
+  if (iend - ip < 6) {
+    return false;
+  }
+  const auto origSize = static_cast<std::uint32_t>(getLe(ip, 4));
+  const auto numSymbols = static_cast<std::uint16_t>(getLe(ip + 4, 2));
+  ip += 6;
 
-struct BitWriter {
-  std::ofstream& os;
-  std::uint8_t current = 0;
-  int bitCount = 0;
+  std::array<std::uint64_t,256> freqs{};
+  freqs.fill(0);
+  if (iend - ip < 5 * static_cast<std::ptrdiff_t>(numSymbols)) {
+    return false;
+  }
+  for (std::uint16_t i = 0; i < numSymbols; ++i) {
+    freqs[ip[0]] = getLe(ip + 1, 4);
+    ip += 5;
+  }
 
-  explicit BitWriter(std::ofstream& out) : os(out) {}
+  if (origSize == 0) {
+    return true; // empty file
+  }
+  // Each symbol takes at least one bit
+  if (origSize > 8 * static_cast<std::uint64_t>(iend - ip)) {
+    return false;
+  }
 
-  void writeBit(bool bit) {
-    current <<= 1;
-    if (bit) {
-      current |= 0x01u;
-    }
-    ++bitCount;
-    if (bitCount == 8) {
-      os.put(static_cast<char>(current));
-      bitCount = 0;
-      current = 0;
-    }
+  // ----- Rebuild tree -----
+  // No root here means something is wrong (non-empty file, zero freqs)
+  HuffTree tree;
+  buildTree(freqs, tree);
+  if (tree.root == kNoNode) {
+    return false;
   }
 
-  void writeBits(const std::vector<bool>& bits) {
-    for (bool b : bits) {
-      writeBit(b);
+  BitReader br(ip, iend);
+  output.resize(origSize);
+  for (std::uint8_t& out : output) {
+    const HuffNode* node = &tree.nodes[tree.root];
+    // Descend until leaf
+    while (!node->isLeaf()) {
+      auto [hasBit, bit] = br.readBit();
+      if (!hasBit) {
+        // Ran out of bits before reconstructing originalSize bytes
+        return false;
+      }
+      node = &tree.nodes[bit ? node->right : node->left];
     }
+    out = node->symbol;
   }
+  return true;
+}
 
-  void flush() {
-    if (bitCount > 0) {
-      current <<= (8 - bitCount); // pad with zeros
-      os.put(static_cast<char>(current));
-      bitCount = 0;
-      current = 0;
+// Decode 'count' symbols, refilling the bit buffer once per kPerRefill
+// symbols (kPerRefill * maxLength must fit in the 56 guaranteed bits)
+template <std::uint32_t kPerRefill>
+void decodeSymbols(const HuffmanDecoder& dec,
+                   HuffmanBitReader& br,
+                   std::uint8_t* op,
+                   std::size_t count) {
+  std::uint8_t* const end = op + count;
+  while (static_cast<std::size_t>(end - op) >= kPerRefill) {
+    br.refill();
+    for (std::uint32_t k = 0; k < kPerRefill; ++k) {
+      *op++ = static_cast<std::uint8_t>(dec.decode(br));
     }
   }
-};
+  while (op < end) {
+    br.refill();
+    *op++ = static_cast<std::uint8_t>(dec.decode(br));
+  }
+}
 
-struct BitReader {
-  std::ifstream& is;
-  std::uint8_t current = 0;
-  int bitsLeft = 0;
+// Decode four streams in lockstep: each round refills all four readers
+// and decodes kPerRefill symbols from each, so the four dependency
+// chains overlap. Stream 3 is the shortest; the others finish alone.
+template <std::uint32_t kPerRefill>
+void decodeSymbols4(const HuffmanDecoder& dec,
+                    HuffmanBitReader* br,
+                    std::uint8_t* op,
+                    std::size_t seg,
+                    std::size_t size) {
+  std::uint8_t* op0 = op;
+  std::uint8_t* op1 = op + seg;
+  std::uint8_t* op2 = op + 2 * seg;
+  std::uint8_t* op3 = op + 3 * seg;
+  const std::size_t last = size - 3 * seg;
+  for (std::size_t round = last / kPerRefill; round > 0; --round) {
+    br[0].refill();
+    br[1].refill();
+    br[2].refill();
+    br[3].refill();
+    for (std::uint32_t k = 0; k < kPerRefill; ++k) {
+      *op0++ = static_cast<std::uint8_t>(dec.decode(br[0]));
+      *op1++ = static_cast<std::uint8_t>(dec.decode(br[1]));
+      *op2++ = static_cast<std::uint8_t>(dec.decode(br[2]));
+      *op3++ = static_cast<std::uint8_t>(dec.decode(br[3]));
+    }
+  }
+  const std::size_t done = (last / kPerRefill) * kPerRefill;
+  decodeSymbols<kPerRefill>(dec, br[0], op0, seg - done);
+  decodeSymbols<kPerRefill>(dec, br[1], op1, seg - done);
+  decodeSymbols<kPerRefill>(dec, br[2], op2, seg - done);
+  decodeSymbols<kPerRefill>(dec, br[3], op3, last - done);
+}
 
-  explicit BitReader(std::ifstream& in) : is(in) {}
+// One bitstream of 'count' symbols in [ip, iend)
+bool decodeStream(const HuffmanDecoder& dec,
+                  const std::uint8_t* ip,
+                  const std::uint8_t* iend,
+                  std::uint8_t* op,
+                  std::size_t count) {
+  HuffmanBitReader br(ip, iend);
+  if (dec.maxLength() <= 11) {
+    decodeSymbols<5>(dec, br, op, count);
+  } else if (dec.maxLength() <= 14) {
+    decodeSymbols<4>(dec, br, op, count);
+  } else {
+    decodeSymbols<3>(dec, br, op, count);
+  }
+  // Running into the padding means the stream was cut short
+  return !br.overrun();
+}
 
-  // Returns (ok, bit). ok=false if we hit EOF.
-  std::pair<bool, bool> readBit() {
-    if (bitsLeft == 0) {
-      char c;
-      if (!is.get(c)) {
-        return {false, false};
-      }
-      current = static_cast<std::uint8_t>(c);
-      bitsLeft = 8;
+// Jump table and four streams holding 'size' symbols in [ip, iend)
+bool decodeStreams4(const HuffmanDecoder& dec,
+                    const std::uint8_t* ip,
+                    const std::uint8_t* iend,
+                    std::uint8_t* op,
+                    std::size_t size) {
+  const std::size_t seg = segmentSize(size);
+  if (3 * seg > size ||
+      static_cast<std::size_t>(iend - ip) < kJumpTableSize) {
+    return false;
+  }
+  const std::uint8_t* bounds[kStreams + 1];
+  bounds[0] = ip + kJumpTableSize;
+  for (std::size_t i = 0; i + 1 < kStreams; ++i) {
+    const std::uint64_t bytes = getLe(ip + 4 * i, 4);
+    if (bytes > static_cast<std::uint64_t>(iend - bounds[i])) {
+      return false;
     }
-    bool bit = (current & 0x80u) != 0;
-    current <<= 1;
-    --bitsLeft;
-    return {true, bit};
+    bounds[i + 1] = bounds[i] + bytes;
+  }
+  bounds[kStreams] = iend;
+
+  HuffmanBitReader br[kStreams] = {
+    HuffmanBitReader(bounds[0], bounds[1]),
+    HuffmanBitReader(bounds[1], bounds[2]),
+    HuffmanBitReader(bounds[2], bounds[3]),
+    HuffmanBitReader(bounds[3], bounds[4])
+  };
+  if (dec.maxLength() <= 11) {
+    decodeSymbols4<5>(dec, br, op, seg, size);
+  } else if (dec.maxLength() <= 14) {
+    decodeSymbols4<4>(dec, br, op, seg, size);
+  } else {
+    decodeSymbols4<3>(dec, br, op, seg, size);
   }
-};
+  return !br[0].overrun() && !br[1].overrun() &&
+         !br[2].overrun() && !br[3].overrun();
+}
+
+// ---------- Container blocks ----------
+
+// Mode byte in front of each block: its code-length table follows, and
+// bit 4 is set when four streams do
+constexpr std::uint8_t kNewTable        = 0x00u;
+constexpr std::uint8_t kFourStreamsFlag = 0x10u;
 
 // Derive output path for decompression
 std::string deriveOutputPath(const std::string& inPath) {
@@ -240,252 +415,206 @@ std::string deriveOutputPath(const std::string& inPath) {
 
 } // namespace
 
-// -------------------- Public API: COMPRESS --------------------
+// -------------------- Public API: levels --------------------
+
+HuffmanOptions huffmanOptionsForLevel(int level) {
+  struct Preset {
+    std::uint32_t blockSize;
+    std::uint32_t maxCodeLength;
+  };
+  constexpr std::uint32_t kK = 1024;
+  static const Preset kPresets[kMaxLevel] = {
+    {4096 * kK, 11},  // 1
+    {1024 * kK, 11},  // 2
+    { 512 * kK, 11},  // 3
+    { 256 * kK, 11},  // 4
+    { 192 * kK, 11},  // 5
+    { 128 * kK, 11},  // 6 (default)
+    {  96 * kK, 11},  // 7
+    {  64 * kK, 11},  // 8
+    {  48 * kK, 11},  // 9
+    {  32 * kK, 11},  // 10
+    {  16 * kK, 12},  // 11
+    {  16 * kK, 15},  // 12
+  };
+
+  if (level < kMinLevel) level = kMinLevel;
+  if (level > kMaxLevel) level = kMaxLevel;
+
+  const Preset& p = kPresets[level - 1];
+  HuffmanOptions o;
+  o.blockSize     = p.blockSize;
+  o.maxCodeLength = p.maxCodeLength;
+  return o;
+}
+
+// -------------------- Public API: DECOMPRESS --------------------
 
-Result huffmanCompressFile(const std::string& inPath) {
+Result huffmanDecompressFile(const std::string& inPath, Context* context) {
   Result r{};
+  std::optional<Context> temporary;
+  Context& ctx = (context != nullptr) ? *context : temporary.emplace();
+  ctx.reset();
 
-  // Open once for size
-  std::ifstream sizeStream(inPath, std::ios::binary | std::ios::ate);
-  if (!sizeStream) {
+  std::ifstream in(inPath, std::ios::binary | std::ios::ate);
+  if (!in) {
     r.error = -1;
     return r;
   }
-  auto size = sizeStream.tellg();
-  sizeStream.close();
-  if (size < 0) {
+  auto fsize = in.tellg();
+  if (fsize < 0) {
     r.error = -1;
     return r;
   }
-  r.bytesIn = static_cast<std::uint32_t>(size);
+  r.bytesIn = static_cast<std::uint32_t>(fsize);
+  in.seekg(0, std::ios::beg);
 
-  // Read entire file
-  std::ifstream in(inPath, std::ios::binary);
-  if (!in) {
+  std::pmr::vector<std::uint8_t> input(static_cast<std::size_t>(fsize), &ctx.job());
+  if (!in.read(reinterpret_cast<char*>(input.data()),
+               static_cast<std::streamsize>(input.size()))) {
     r.error = -1;
     return r;
   }
-  std::vector<std::uint8_t> data;
-  data.assign(std::istreambuf_iterator<char>(in),
-              std::istreambuf_iterator<char>());
   in.close();
 
-  if (data.empty()) {
-    // Empty file: just write header with zero symbols
-    const std::string outPath = inPath + ".huff";
-    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
-    if (!out) {
-      r.error = -2;
-      return r;
-    }
-    // Magic
-    out.write("HUF1", 4);
-    // original size = 0
-    writeUint32(out, 0);
-    // symbol count = 0
-    writeUint16(out, 0);
-    out.close();
-    r.bytesOut = 4 + 4 + 2;
-    r.error = 0;
+  // ----- Check magic and decode -----
+  if (input.size() < kMagicSize) {
+    r.error = -3;
     return r;
   }
-
-  // Build frequency table
-  std::array<std::uint64_t,256> freqs{};
-  freqs.fill(0);
-  for (std::uint8_t b : data) {
-    freqs[b]++;
+  const std::uint8_t* ip = input.data() + kMagicSize;
+  const std::uint8_t* iend = input.data() + input.size();
+  if (!isHuf1(input.data())) {
+    r.error = -3; // not a recognized Huffman format
+    return r;
   }
 
-  // Build tree
-  HuffNode* root = buildTree(freqs);
-
-  // Build code table
-  std::array<std::vector<bool>,256> codes;
-  std::vector<bool> prefix;
-  buildCodeTable(root, prefix, codes);
-
-  // Count number of distinct symbols
-  std::uint16_t numSymbols = 0;
-  for (std::size_t i = 0; i < 256; ++i) {
-    if (freqs[i] > 0) {
-      ++numSymbols;
-    }
+  std::pmr::vector<std::uint8_t> output(&ctx.job());
+  if (!decodeHuf1(ip, iend, output)) {
+    r.error = -3;
+    return r;
   }
 
-  const std::string outPath = inPath + ".huff";
+  // ----- Write output file -----
+  const std::string outPath = deriveOutputPath(inPath);
   std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
   if (!out) {
-    freeTree(root);
     r.error = -2;
     return r;
   }
-
-  // ----- Write header -----
-  // Magic
-  out.write("HUF1", 4);
-
-  // Original size
-  writeUint32(out, static_cast<std::uint32_t>(data.size()));
-
-  // Symbol count
-  writeUint16(out, numSymbols);
-
-  // For each symbol, write symbol + freq
-  for (std::size_t i = 0; i < 256; ++i) {
-    if (freqs[i] > 0) {
-      std::uint8_t sym = static_cast<std::uint8_t>(i);
-      out.put(static_cast<char>(sym));
-      writeUint32(out, static_cast<std::uint32_t>(freqs[i]));
-    }
-  }
-
-  // ----- Write encoded bitstream -----
-  BitWriter bw(out);
-  for (std::uint8_t b : data) {
-    const auto& code = codes[b];
-    bw.writeBits(code);
+  if (!output.empty()) {
+    out.write(reinterpret_cast<const char*>(output.data()),
+              static_cast<std::streamsize>(output.size()));
   }
-  bw.flush();
-
-  out.flush();
-  r.bytesOut = static_cast<std::uint32_t>(out.tellp());
   out.close();
 
-  freeTree(root);
+  r.bytesOut = static_cast<std::uint32_t>(output.size());
   r.error = 0;
   return r;
 }
 
-// -------------------- Public API: DECOMPRESS --------------------
-
-Result huffmanDecompressFile(const std::string& inPath) {
-  Result r{};
-
-  std::ifstream in(inPath, std::ios::binary | std::ios::ate);
-  if (!in) {
-    r.error = -1;
-    return r;
-  }
-  auto fsize = in.tellg();
-  if (fsize < 0) {
-    r.error = -1;
-    return r;
-  }
-  r.bytesIn = static_cast<std::uint32_t>(fsize);
-  in.seekg(0, std::ios::beg);
-
-  // ----- Read header -----
-  char magic[4];
-  if (!in.read(magic, 4)) {
-    r.error = -3;
-    return r;
-  }
-  if (!(magic[0] == 'H' && magic[1] == 'U' && magic[2] == 'F' && magic[3] == '1')) {
-    r.error = -3; // not a recognized Huffman format
-    return r;
-  }
+// -------------------- Public API: container blocks --------------------
 
-  bool ok = true;
-  std::uint32_t origSize = readUint32(in, ok);
-  if (!ok) {
-    r.error = -3;
-    return r;
+std::uint32_t HuffmanBlockCodec::blockSize() const {
+  if (m_options.blockSize == 0) {
+    return kHuffMaxBlockSize;
   }
+  return std::min(std::max(m_options.blockSize, kHuffMinBlockSize), kHuffMaxBlockSize);
+}
 
-  std::uint16_t numSymbols = readUint16(in, ok);
-  if (!ok) {
-    r.error = -3;
-    return r;
-  }
+std::size_t HuffmanBlockCodec::scratchBytes(std::size_t n) const {
+  // A block is only coded when it comes out smaller than n
+  return std::max(1 + kMaxTableSize + kJumpTableSize + kStreams + n,
+                  sizeof(HuffmanDecoder)) + 64;
+}
 
+bool HuffmanBlockCodec::encodeBlock(const std::uint8_t* in,
+                                    std::size_t n,
+                                    Arena& scratch,
+                                    std::pmr::vector<std::uint8_t>& out) const {
+  (void)scratch;
   std::array<std::uint64_t,256> freqs{};
-  freqs.fill(0);
+  histogramCount(in, n, freqs.data());
+  std::uint8_t lengths[256];
+  huffmanCodeLengths(freqs.data(), 256, m_options.maxCodeLength, lengths);
+  HuffmanEncoder enc;
+  if (!enc.init(lengths, 256)) {
+    return false;
+  }
+
+  // Skip the coding when the block would be stored anyway
+  const bool fourStreams = m_options.streams == 4 && n >= kMinFourStreamSize;
+  out.reserve(1 + kMaxTableSize);
+  out.push_back(fourStreams ? (kNewTable | kFourStreamsFlag) : kNewTable);
+  huffmanWriteLengths(out, lengths, 256);
+  const std::size_t start = out.size();
+  const std::uint64_t bytes = (enc.encodedBits(freqs.data()) + 7) / 8;
+  if (start + bytes + (fourStreams ? kJumpTableSize : 0) >= n) {
+    return false;
+  }
+
+  out.resize(start + kJumpTableSize + kStreams + static_cast<std::size_t>(bytes) + 8);
+  const std::size_t payload =
+      fourStreams ? encodeStreams4(enc, in, n, out.data() + start)
+                  : encodeStream(enc, in, n, out.data() + start);
+  out.resize(start + payload);
+  return true;
+}
 
-  for (std::uint16_t i = 0; i < numSymbols; ++i) {
-    char symChar;
-    if (!in.get(symChar)) {
-      r.error = -3;
-      return r;
-    }
-    std::uint8_t sym = static_cast<std::uint8_t>(symChar);
-    std::uint32_t f = readUint32(in, ok);
-    if (!ok) {
-      r.error = -3;
-      return r;
-    }
-    freqs[sym] = f;
-  }
+bool HuffmanBlockCodec::decodeBlock(const std::uint8_t* in,
+                                    std::size_t size,
+                                    std::uint8_t* out,
+                                    std::size_t n,
+                                    Arena& scratch) const {
+  const std::uint8_t* ip = in;
+  const std::uint8_t* const iend = in + size;
+  if (ip >= iend || (*ip & ~kFourStreamsFlag) != kNewTable) {
+    return false;
+  }
+  const bool fourStreams = (*ip++ & kFourStreamsFlag) != 0;
+  std::uint8_t lengths[256];
+  // Off the stack: block 0 decodes on the calling thread
+  HuffmanDecoder& dec = *new (scratch.alloc<HuffmanDecoder>(1)) HuffmanDecoder;
+  if (!huffmanReadLengths(ip, iend, lengths, 256) || !dec.init(lengths, 256)) {
+    return false;
+  }
+  return fourStreams ? decodeStreams4(dec, ip, iend, out, n)
+                     : decodeStream(dec, ip, iend, out, n);
+}
 
-  // ----- Rebuild tree -----
-  HuffNode* root = buildTree(freqs);
+// -------------------- Codec registration --------------------
 
-  // Edge case: empty file
-  if (origSize == 0) {
-    const std::string outPath = deriveOutputPath(inPath);
-    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
-    if (!out) {
-      freeTree(root);
-      r.error = -2;
-      return r;
-    }
-    out.close();
-    r.bytesOut = 0;
-    r.error = 0;
-    freeTree(root);
-    return r;
+namespace {
+
+class HuffmanCodec final : public Codec {
+public:
+  Algorithm algorithm() const override { return Algorithm::HUFFMAN; }
+  const char* name() const override { return "HUFFMAN"; }
+  const char* extension() const override { return ".huff"; }
+  CodecCapabilities capabilities() const override {
+    return kContainerCodecCapabilities;
   }
 
-  // If root is nullptr here, something is wrong (non-empty file, zero freqs)
-  if (!root) {
-    r.error = -3;
-    return r;
+  BlockCodec* makeBlockCodec(int level, void* storage) const override {
+    static_assert(sizeof(HuffmanBlockCodec) <= kBlockCodecStorage);
+    return new (storage) HuffmanBlockCodec(huffmanOptionsForLevel(level));
   }
 
-  // ----- Decode bitstream -----
-  BitReader br(in);
-  std::vector<std::uint8_t> output;
-  output.reserve(origSize);
+  // HUF1, the format releases before the container wrote
+  bool ownsMagic(const std::uint8_t* magic) const override {
+    return isHuf1(magic);
+  }
 
-  while (output.size() < origSize) {
-    HuffNode* node = root;
-    // Descend until leaf
-    while (!node->isLeaf()) {
-      auto [hasBit, bit] = br.readBit();
-      if (!hasBit) {
-        // Ran out of bits before reconstructing originalSize bytes
-        freeTree(root);
-        r.error = -3;
-        return r;
-      }
-      node = bit ? node->right : node->left;
-      if (!node) {
-        freeTree(root);
-        r.error = -3;
-        return r;
-      }
-    }
-    output.push_back(node->symbol);
+  Result decompressFile(const std::string& path,
+                        Context* context) const override {
+    return huffmanDecompressFile(path, context);
   }
+};
 
-  freeTree(root);
+const HuffmanCodec kHuffmanCodec;
 
-  // ----- Write output file -----
-  const std::string outPath = deriveOutputPath(inPath);
-  std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
-  if (!out) {
-    r.error = -2;
-    return r;
-  }
-  if (!output.empty()) {
-    out.write(reinterpret_cast<const char*>(output.data()),
-              static_cast<std::streamsize>(output.size()));
-  }
-  out.close();
+} // namespace
 
-  r.bytesOut = static_cast<std::uint32_t>(output.size());
-  r.error = 0;
-  return r;
-}
+const CodecRegistration huffmanCodecRegistration(kHuffmanCodec);
 
 } // namespace CompressionLib
@@ -4,13 +4,72 @@
 #include <cstdint>
 #include <string>
 #include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
+#include "compress/Lib/CompressionLib/HuffmanCode.hpp"
 
 namespace CompressionLib {
 
-  // returns Result with .error = 0 on success
-  Result huffmanCompressFile(const std::string& inPath);
+  // Canonical Huffman codes, one table per container block (see
+  // Container.hpp). A block is a mode byte (0, plus bit 4 for four
+  // streams), the code-length table (see huffmanWriteLengths) and the
+  // codes packed MSB-first, in one bitstream or, for four streams, a jump
+  // table of three u32 stream sizes followed by streams 0..3. Streams
+  // 0..2 code ceil(size / 4) bytes each and stream 3 the rest, so the
+  // decoder can run all four at once. Any block decodes alone; the
+  // container stores blocks that would not shrink. There are no codec
+  // parameters.
+  struct HuffmanOptions {
+    // Longest code the encoder may use, 11..15 bits
+    std::uint32_t maxCodeLength = kHuffMinLengthLimit;
+    // 4 = four streams (faster decode), 1 = one. Blocks under 1 KiB
+    // always use a single stream.
+    std::uint32_t streams = 4;
+    // Input bytes per block, each with its own table, clamped to
+    // [kHuffMinBlockSize, kHuffMaxBlockSize]; 0 = kHuffMaxBlockSize
+    std::uint32_t blockSize = 0;
+  };
+
+  constexpr std::uint32_t kHuffMinBlockSize     = 16 * 1024;
+  constexpr std::uint32_t kHuffMaxBlockSize     = 64 * 1024 * 1024;
+  constexpr std::uint32_t kHuffDefaultBlockSize = 128 * 1024;
+
+  // Options for a compression level (see CompressionLib.hpp); smaller
+  // blocks let tables follow the data more closely. Out-of-range levels
+  // are clamped.
+  //   1      4 MiB blocks
+  //   2-10   1 MiB down to 32 KiB blocks (6 = 128 KiB)
+  //   11-12  16 KiB blocks, codes up to 12 / 15 bits
+  HuffmanOptions huffmanOptionsForLevel(int level);
+
+  // Decompress a HUF1 .huff file, the format releases before the
+  // container wrote: "HUF1", u32 size, u16 symbol count, (u8 symbol,
+  // u32 freq) per symbol, then codes from the frequency-built tree.
+  // Working memory comes from 'ctx' (nullptr = a context for this call).
+  Result huffmanDecompressFile(const std::string& inPath,
+                               Context* ctx = nullptr);
+
+  class HuffmanBlockCodec final : public BlockCodec {
+  public:
+    explicit HuffmanBlockCodec(const HuffmanOptions& options = HuffmanOptions{})
+      : m_options(options) {}
+
+    std::uint32_t blockSize() const override;
+    std::size_t scratchBytes(std::size_t n) const override;
+    bool encodeBlock(const std::uint8_t* in,
+                     std::size_t n,
+                     Arena& scratch,
+                     std::pmr::vector<std::uint8_t>& out) const override;
+    bool decodeBlock(const std::uint8_t* in,
+                     std::size_t size,
+                     std::uint8_t* out,
+                     std::size_t n,
+                     Arena& scratch) const override;
+
+  private:
+    HuffmanOptions m_options;
+  };
 
-    Result huffmanDecompressFile(const std::string& inPath);
 } // namespace CompressionLib
 
 #endif
@@ -0,0 +1,446 @@
+#include "compress/Lib/CompressionLib/HuffmanCode.hpp"
+
+#include <algorithm>
+
+namespace CompressionLib {
+
+namespace {
+
+enum LengthTableMode : std::uint8_t {
+  kNibbles = 0,
+  kRuns    = 1
+};
+
+constexpr std::size_t kMaxRun = 16;
+
+void putVarint(std::pmr::vector<std::uint8_t>& out, std::uint32_t v) {
+  while (v >= 0x80u) {
+    out.push_back(static_cast<std::uint8_t>((v & 0x7Fu) | 0x80u));
+    v >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool getVarint(const std::uint8_t*& ip,
+               const std::uint8_t* iend,
+               std::uint32_t& v) {
+  v = 0;
+  for (unsigned shift = 0; shift < 32; shift += 7) {
+    if (ip >= iend) {
+      return false;
+    }
+    const std::uint8_t b = *ip++;
+    v |= static_cast<std::uint32_t>(b & 0x7Fu) << shift;
+    if ((b & 0x80u) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Moffat & Katajainen's in-place minimum-redundancy code. a[0..n) holds
+// weights in ascending order (n >= 2); on return a[i] is the code length
+// of the i-th weight. The array doubles as the tree: first parent links,
+// then internal node depths, then leaf depths.
+void minimumRedundancy(std::uint64_t* a, std::size_t n) {
+  // Pass 1, left to right: combine the two lightest of the leaves and
+  // the internal nodes built so far; a[next] becomes a weight, roots a
+  // parent index
+  a[0] += a[1];
+  std::size_t root = 0;
+  std::size_t leaf = 2;
+  for (std::size_t next = 1; next < n - 1; ++next) {
+    if (leaf >= n || a[root] < a[leaf]) {
+      a[next] = a[root];
+      a[root++] = next;
+    } else {
+      a[next] = a[leaf++];
+    }
+    if (leaf >= n || (root < next && a[root] < a[leaf])) {
+      a[next] += a[root];
+      a[root++] = next;
+    } else {
+      a[next] += a[leaf++];
+    }
+  }
+
+  // Pass 2, right to left: parent indices to internal node depths
+  a[n - 2] = 0;
+  for (std::size_t next = n - 2; next-- > 0;) {
+    a[next] = a[a[next]] + 1;
+  }
+
+  // Pass 3, right to left: internal node depths to leaf depths
+  std::size_t avail = 1;
+  std::size_t used = 0;
+  std::uint64_t depth = 0;
+  std::size_t rootPos = n - 1; // one past the next internal node
+  std::size_t next = n;        // one past the next leaf
+  while (avail > 0) {
+    while (rootPos > 0 && a[rootPos - 1] == depth) {
+      ++used;
+      --rootPos;
+    }
+    while (avail > used) {
+      a[--next] = depth;
+      --avail;
+    }
+    avail = 2 * used;
+    ++depth;
+    used = 0;
+  }
+}
+
+// Optimal lengths of at most maxLength bits via package-merge, for
+// weights w[0..n) in ascending order; adds each length to len[i].
+//
+// List k holds the leaves merged with the packages (adjacent pairs) of
+// list k - 1, in weight order. Taking the 2n - 2 lightest items of the
+// last list gives the optimal code: each leaf's length is the number of
+// times it is taken, directly or inside a package. Leaves enter every
+// list lightest first, so the items taken from a list always include a
+// prefix of the leaves; only the leaf/package pattern of each list is
+// kept, as a bit mask, and weights just for the two lists in play.
+void packageMerge(const std::uint64_t* w,
+                  std::size_t n,
+                  std::uint32_t maxLength,
+                  std::uint8_t* len) {
+  constexpr std::size_t kMaxItems = 2 * kHuffMaxSymbols;
+  constexpr std::size_t kMaskWords = kMaxItems / 64;
+  std::uint64_t weights[2][kMaxItems];
+  std::uint64_t isLeaf[kHuffMaxCodeLength][kMaskWords] = {};
+
+  std::uint64_t* prev = weights[0];
+  std::uint64_t* list = weights[1];
+  std::size_t prevSize = n;
+  for (std::size_t i = 0; i < n; ++i) {
+    prev[i] = w[i];
+    isLeaf[0][i / 64] |= std::uint64_t(1) << (i % 64);
+  }
+  std::size_t sizes[kHuffMaxCodeLength];
+  sizes[0] = n;
+  for (std::uint32_t k = 1; k < maxLength; ++k) {
+    std::size_t size = 0;
+    std::size_t leaf = 0;
+    std::size_t pair = 0;
+    while (leaf < n || pair + 1 < prevSize) {
+      const bool havePair = pair + 1 < prevSize;
+      const std::uint64_t pairWeight = havePair ? prev[pair] + prev[pair + 1] : 0;
+      // Leaves win ties so shallow codes go to single symbols
+      if (leaf < n && (!havePair || w[leaf] <= pairWeight)) {
+        isLeaf[k][size / 64] |= std::uint64_t(1) << (size % 64);
+        list[size++] = w[leaf++];
+      } else {
+        list[size++] = pairWeight;
+        pair += 2;
+      }
+    }
+    sizes[k] = size;
+    prevSize = size;
+    std::swap(prev, list);
+  }
+
+  // Walk back down: packages taken at list k select a prefix of list k-1
+  std::size_t take = 2 * n - 2;
+  for (std::uint32_t k = maxLength; k-- > 0;) {
+    std::size_t leaves = 0;
+    for (std::size_t i = 0; i < take && i < sizes[k]; ++i) {
+      leaves += (isLeaf[k][i / 64] >> (i % 64)) & 1u;
+    }
+    for (std::size_t i = 0; i < leaves; ++i) {
+      ++len[i];
+    }
+    take = 2 * (take - leaves);
+  }
+}
+
+// Number of (length, run) bytes needed for lengths[0..n)
+std::size_t runBytes(const std::uint8_t* lengths, std::size_t n) {
+  std::size_t bytes = 0;
+  for (std::size_t i = 0; i < n;) {
+    std::size_t run = 1;
+    while (i + run < n && run < kMaxRun && lengths[i + run] == lengths[i]) {
+      ++run;
+    }
+    ++bytes;
+    i += run;
+  }
+  return bytes;
+}
+
+} // namespace
+
+// -------------------- Code lengths --------------------
+
+void huffmanCodeLengths(const std::uint64_t* freqs,
+                        std::size_t count,
+                        std::uint32_t maxLength,
+                        std::uint8_t* lengths) {
+  if (maxLength < kHuffMinLengthLimit) maxLength = kHuffMinLengthLimit;
+  if (maxLength > kHuffMaxCodeLength) maxLength = kHuffMaxCodeLength;
+
+  std::uint16_t order[kHuffMaxSymbols];
+  std::size_t n = 0;
+  for (std::size_t s = 0; s < count; ++s) {
+    lengths[s] = 0;
+    if (freqs[s] > 0) {
+      order[n++] = static_cast<std::uint16_t>(s);
+    }
+  }
+  if (n == 0) {
+    return;
+  }
+  if (n == 1) {
+    lengths[order[0]] = 1; // still needs one bit per symbol
+    return;
+  }
+  std::sort(order, order + n, [&](std::uint16_t a, std::uint16_t b) {
+    return freqs[a] < freqs[b] || (freqs[a] == freqs[b] && a < b);
+  });
+
+  // Unlimited optimal lengths, longest first. When even the longest
+  // fits (the usual case) they are the answer.
+  std::uint64_t depth[kHuffMaxSymbols];
+  for (std::size_t i = 0; i < n; ++i) {
+    depth[i] = freqs[order[i]];
+  }
+  minimumRedundancy(depth, n);
+  if (depth[0] <= maxLength) {
+    for (std::size_t i = 0; i < n; ++i) {
+      lengths[order[i]] = static_cast<std::uint8_t>(depth[i]);
+    }
+    return;
+  }
+
+  // Too deep: redo the code under the limit
+  std::uint8_t limited[kHuffMaxSymbols] = {};
+  for (std::size_t i = 0; i < n; ++i) {
+    depth[i] = freqs[order[i]];
+  }
+  packageMerge(depth, n, maxLength, limited);
+  for (std::size_t i = 0; i < n; ++i) {
+    lengths[order[i]] = limited[i];
+  }
+}
+
+// -------------------- Canonical codes --------------------
+
+bool huffmanCanonicalCodes(const std::uint8_t* lengths,
+                           std::size_t count,
+                           std::uint32_t* codes) {
+  std::uint32_t perLength[kHuffMaxCodeLength + 1] = {};
+  for (std::size_t s = 0; s < count; ++s) {
+    if (lengths[s] > kHuffMaxCodeLength) {
+      return false;
+    }
+    ++perLength[lengths[s]];
+  }
+  perLength[0] = 0; // unused symbols take no code space
+
+  // First code of each length, as in DEFLATE
+  std::uint32_t next[kHuffMaxCodeLength + 1] = {};
+  std::uint32_t code = 0;
+  std::uint32_t used = 0; // code space taken, in units of 2^-15
+  for (std::uint32_t len = 1; len <= kHuffMaxCodeLength; ++len) {
+    code = (code + perLength[len - 1]) << 1;
+    next[len] = code;
+    used += perLength[len] << (kHuffMaxCodeLength - len);
+  }
+  if (used > (1u << kHuffMaxCodeLength)) {
+    return false;
+  }
+
+  for (std::size_t s = 0; s < count; ++s) {
+    codes[s] = (lengths[s] == 0) ? 0 : next[lengths[s]]++;
+  }
+  return true;
+}
+
+// -------------------- Table encoder --------------------
+
+bool HuffmanEncoder::init(const std::uint8_t* lengths, std::size_t count) {
+  m_count = 0;
+  m_maxLength = 0;
+
+  std::uint32_t codes[kHuffMaxSymbols];
+  if (count > kHuffMaxSymbols || !huffmanCanonicalCodes(lengths, count, codes)) {
+    return false;
+  }
+  m_count = count;
+  for (std::size_t s = 0; s < count; ++s) {
+    m_table[s].code = static_cast<std::uint16_t>(codes[s]);
+    m_table[s].length = lengths[s];
+    if (lengths[s] > m_maxLength) {
+      m_maxLength = lengths[s];
+    }
+  }
+  return true;
+}
+
+// -------------------- Table decoder --------------------
+
+bool HuffmanDecoder::init(const std::uint8_t* lengths, std::size_t count) {
+  m_maxLength = 0;
+
+  std::uint32_t codes[kHuffMaxSymbols];
+  if (count == 0 || count > kHuffMaxSymbols ||
+      !huffmanCanonicalCodes(lengths, count, codes)) {
+    return false;
+  }
+  std::uint32_t used = 0;
+  std::size_t symbols = 0;
+  std::size_t lastSymbol = 0;
+  for (std::size_t s = 0; s < count; ++s) {
+    if (lengths[s] > 0) {
+      used += 1u << (kHuffMaxCodeLength - lengths[s]);
+      ++symbols;
+      lastSymbol = s;
+      if (lengths[s] > m_maxLength) {
+        m_maxLength = lengths[s];
+      }
+    }
+  }
+
+  const std::uint32_t primarySize = 1u << kTableBits;
+  if (symbols == 1 && lengths[lastSymbol] == 1) {
+    // One-symbol code: every bit pattern means that symbol
+    std::fill(m_table, m_table + primarySize,
+              static_cast<std::uint32_t>(lastSymbol) | (1u << 16));
+    return true;
+  }
+  if (used != (1u << kHuffMaxCodeLength)) {
+    return false; // incomplete code would leave holes in the table
+  }
+  std::fill(m_table, m_table + primarySize, 0u);
+
+  // Secondary tables: one per primary slot that long codes share, wide
+  // enough for the longest code under that prefix
+  std::uint8_t subWidth[std::size_t(1) << kTableBits] = {};
+  for (std::size_t s = 0; s < count; ++s) {
+    const std::uint32_t len = lengths[s];
+    if (len > kTableBits) {
+      const std::uint32_t prefix = codes[s] >> (len - kTableBits);
+      if (len - kTableBits > subWidth[prefix]) {
+        subWidth[prefix] = static_cast<std::uint8_t>(len - kTableBits);
+      }
+    }
+  }
+  std::size_t size = primarySize;
+  for (std::uint32_t prefix = 0; prefix < primarySize; ++prefix) {
+    if (subWidth[prefix] > 0) {
+      const std::size_t width = subWidth[prefix];
+      m_table[prefix] = kSubTableFlag | static_cast<std::uint32_t>(width << 16) |
+                        static_cast<std::uint32_t>(size);
+      std::fill(m_table + size, m_table + size + (std::size_t(1) << width), 0u);
+      size += std::size_t(1) << width;
+    }
+  }
+
+  // Each code fills every slot whose leading bits are the code
+  for (std::size_t s = 0; s < count; ++s) {
+    const std::uint32_t len = lengths[s];
+    if (len == 0) {
+      continue;
+    }
+    const auto sym = static_cast<std::uint32_t>(s);
+    if (len <= kTableBits) {
+      const std::uint32_t first = codes[s] << (kTableBits - len);
+      const std::uint32_t span = 1u << (kTableBits - len);
+      for (std::uint32_t i = 0; i < span; ++i) {
+        m_table[first + i] = sym | (len << 16);
+      }
+    } else {
+      const std::uint32_t rest = len - kTableBits;
+      const std::uint32_t prefix = codes[s] >> rest;
+      const std::uint32_t width = subWidth[prefix];
+      const std::uint32_t base = m_table[prefix] & 0xFFFFu;
+      const std::uint32_t low = codes[s] & ((1u << rest) - 1u);
+      const std::uint32_t first = low << (width - rest);
+      const std::uint32_t span = 1u << (width - rest);
+      for (std::uint32_t i = 0; i < span; ++i) {
+        m_table[base + first + i] = sym | (rest << 16);
+      }
+    }
+  }
+  return true;
+}
+
+// -------------------- Length tables --------------------
+
+void huffmanWriteLengths(std::pmr::vector<std::uint8_t>& out,
+                         const std::uint8_t* lengths,
+                         std::size_t count) {
+  std::size_t n = count;
+  while (n > 0 && lengths[n - 1] == 0) {
+    --n;
+  }
+
+  const std::size_t nibbleBytes = (n + 1) / 2;
+  const bool runs = runBytes(lengths, n) < nibbleBytes;
+  out.push_back(runs ? kRuns : kNibbles);
+  putVarint(out, static_cast<std::uint32_t>(n));
+
+  if (!runs) {
+    for (std::size_t i = 0; i < n; i += 2) {
+      const std::uint8_t hi = (i + 1 < n) ? lengths[i + 1] : 0;
+      out.push_back(static_cast<std::uint8_t>(lengths[i] | (hi << 4)));
+    }
+    return;
+  }
+
+  for (std::size_t i = 0; i < n;) {
+    std::size_t run = 1;
+    while (i + run < n && run < kMaxRun && lengths[i + run] == lengths[i]) {
+      ++run;
+    }
+    out.push_back(static_cast<std::uint8_t>((lengths[i] << 4) | (run - 1)));
+    i += run;
+  }
+}
+
+bool huffmanReadLengths(const std::uint8_t*& ip,
+                        const std::uint8_t* iend,
+                        std::uint8_t* lengths,
+                        std::size_t count) {
+  std::fill(lengths, lengths + count, static_cast<std::uint8_t>(0));
+  if (ip >= iend) {
+    return false;
+  }
+  const std::uint8_t mode = *ip++;
+  std::uint32_t n = 0;
+  if (!getVarint(ip, iend, n) || n > count) {
+    return false;
+  }
+
+  if (mode == kNibbles) {
+    const std::size_t bytes = (static_cast<std::size_t>(n) + 1) / 2;
+    if (static_cast<std::size_t>(iend - ip) < bytes) {
+      return false;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::uint8_t b = ip[i / 2];
+      lengths[i] = static_cast<std::uint8_t>((i & 1u) ? (b >> 4) : (b & 0x0Fu));
+    }
+    ip += bytes;
+    return true;
+  }
+
+  if (mode != kRuns) {
+    return false;
+  }
+  for (std::size_t i = 0; i < n;) {
+    if (ip >= iend) {
+      return false;
+    }
+    const std::uint8_t b = *ip++;
+    const std::size_t run = static_cast<std::size_t>(b & 0x0Fu) + 1;
+    if (run > n - i) {
+      return false;
+    }
+    std::fill(lengths + i, lengths + i + run, static_cast<std::uint8_t>(b >> 4));
+    i += run;
+  }
+  return true;
+}
+
+} // namespace CompressionLib
@@ -0,0 +1,271 @@
+#ifndef COMPRESSION_LIB_HUFFMAN_CODE_HPP
+#define COMPRESSION_LIB_HUFFMAN_CODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+namespace CompressionLib {
+
+  // Code lengths are limited to this range. 15 is the most a 4-bit length
+  // field holds; limits below 11 cost too much ratio on 256 symbols.
+  constexpr std::uint32_t kHuffMinLengthLimit = 11;
+  constexpr std::uint32_t kHuffMaxCodeLength  = 15;
+
+  // Largest alphabet the builders and tables below accept. Everything is
+  // sized from this at compile time, so nothing here touches the heap.
+  constexpr std::size_t kHuffMaxSymbols = 512;
+
+  /**
+   * Length-limited code lengths, built in place on the stack.
+   *
+   * Optimal lengths come from Moffat & Katajainen's in-place algorithm.
+   * Only if one exceeds maxLength is the code rebuilt with package-merge,
+   * which stays optimal under the limit (about 24 KiB of stack).
+   *
+   * freqs and lengths have 'count' entries. Symbols with frequency 0 get
+   * length 0; a lone used symbol gets length 1. maxLength is clamped to
+   * [kHuffMinLengthLimit, kHuffMaxCodeLength]; count must not exceed
+   * kHuffMaxSymbols.
+   */
+  void huffmanCodeLengths(const std::uint64_t* freqs,
+                          std::size_t count,
+                          std::uint32_t maxLength,
+                          std::uint8_t* lengths);
+
+  /**
+   * Canonical codes for a set of lengths: codes of one length are
+   * consecutive in symbol order and shorter codes sort first, so the
+   * lengths alone define the code. codes[s] holds the code of symbol s in
+   * its low lengths[s] bits, first bit most significant. Returns false if
+   * the lengths over-subscribe the code space.
+   */
+  bool huffmanCanonicalCodes(const std::uint8_t* lengths,
+                             std::size_t count,
+                             std::uint32_t* codes);
+
+  /**
+   * Code-length table as stored in a header: a mode byte, a varint n
+   * (symbols >= n have length 0), then either n 4-bit lengths packed two
+   * per byte (low nibble first) or run-length pairs, one byte each:
+   * (length << 4) | (run - 1). The writer picks whichever is shorter.
+   */
+  void huffmanWriteLengths(std::pmr::vector<std::uint8_t>& out,
+                           const std::uint8_t* lengths,
+                           std::size_t count);
+
+  // Parse a table written by huffmanWriteLengths into lengths[0..count).
+  // Advances ip; false on truncated or malformed input.
+  bool huffmanReadLengths(const std::uint8_t*& ip,
+                          const std::uint8_t* iend,
+                          std::uint8_t* lengths,
+                          std::size_t count);
+
+  /**
+   * MSB-first bit writer into a preallocated buffer. Codes collect in the
+   * top of a 64-bit accumulator; flush() stores it as one 8-byte word and
+   * advances past the whole bytes, so the buffer needs 8 bytes of slack
+   * beyond the last byte written. Between flushes at most 57 bits may be
+   * put (e.g. 3 codes of 15 bits or 5 of 11).
+   */
+  class HuffmanBitWriter {
+  public:
+    explicit HuffmanBitWriter(std::uint8_t* begin) : m_begin(begin), m_op(begin) {}
+
+    // Append the low 'len' bits (1..32) of code, most significant first
+    void put(std::uint32_t code, std::uint32_t len) {
+      m_bits |= static_cast<std::uint64_t>(code) << (64 - m_count - len);
+      m_count += len;
+    }
+
+    void flush() {
+      storeBe64(m_op, m_bits);
+      m_op += m_count >> 3;
+      m_bits <<= m_count & ~7u;
+      m_count &= 7u;
+    }
+
+    // Write out the last partial byte (zero padded); returns bytes written
+    std::size_t finish() {
+      flush();
+      if (m_count > 0) {
+        ++m_op;
+        m_bits = 0;
+        m_count = 0;
+      }
+      return static_cast<std::size_t>(m_op - m_begin);
+    }
+
+  private:
+    static void storeBe64(std::uint8_t* p, std::uint64_t v) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      v = __builtin_bswap64(v);
+      std::memcpy(p, &v, 8);
+#else
+      for (int i = 7; i >= 0; --i) {
+        p[i] = static_cast<std::uint8_t>(v);
+        v >>= 8;
+      }
+#endif
+    }
+
+    std::uint8_t* m_begin;
+    std::uint8_t* m_op;
+    std::uint64_t m_bits = 0;
+    std::uint32_t m_count = 0;
+  };
+
+  /**
+   * Canonical encoder: (code, length) per symbol packed in one table so
+   * encoding a symbol is a single load.
+   */
+  class HuffmanEncoder {
+  public:
+    // false if the lengths over-subscribe the code space or count
+    // exceeds kHuffMaxSymbols
+    bool init(const std::uint8_t* lengths, std::size_t count);
+
+    std::uint32_t maxLength() const { return m_maxLength; }
+
+    // Bits needed for a histogram of the same symbols
+    std::uint64_t encodedBits(const std::uint64_t* freqs) const {
+      std::uint64_t bits = 0;
+      for (std::size_t s = 0; s < m_count; ++s) {
+        bits += freqs[s] * m_table[s].length;
+      }
+      return bits;
+    }
+
+    void encode(HuffmanBitWriter& bw, std::uint32_t sym) const {
+      const Entry e = m_table[sym];
+      bw.put(e.code, e.length);
+    }
+
+  private:
+    struct Entry {
+      std::uint16_t code;
+      std::uint16_t length;
+    };
+
+    Entry m_table[kHuffMaxSymbols];
+    std::size_t m_count = 0;
+    std::uint32_t m_maxLength = 0;
+  };
+
+  /**
+   * MSB-first bit reader over an in-memory buffer, matching the order the
+   * encoders pack codes in. Bits are consumed from the top of a 64-bit
+   * container that refill() tops up to at least 56 bits, eight bytes at a
+   * time away from the end. Past the end it supplies zero bits and
+   * overrun() turns true once any of those are consumed.
+   */
+  class HuffmanBitReader {
+  public:
+    HuffmanBitReader(const std::uint8_t* begin, const std::uint8_t* end)
+      : m_ip(begin), m_end(end) {
+      refill();
+    }
+
+    void refill() {
+      if (m_end - m_ip >= 8) {
+        // Whole bytes that fit go in; the partial byte at the bottom is
+        // loaded again (same bits) on the next refill
+        m_bits |= loadBe64(m_ip) >> m_count;
+        m_ip += (63 - m_count) >> 3;
+        m_count |= 56;
+        return;
+      }
+      while (m_count <= 56) {
+        std::uint64_t byte = 0;
+        if (m_ip < m_end) {
+          byte = *m_ip++;
+        } else {
+          ++m_padBytes;
+        }
+        m_bits |= byte << (56 - m_count);
+        m_count += 8;
+      }
+    }
+
+    // Next n bits (1..32) without consuming them
+    std::uint32_t peek(std::uint32_t n) const {
+      return static_cast<std::uint32_t>(m_bits >> (64 - n));
+    }
+
+    void skip(std::uint32_t n) {
+      m_bits <<= n;
+      m_count -= n;
+    }
+
+    // True once bits beyond the end of the buffer have been consumed
+    bool overrun() const { return 8 * m_padBytes > m_count; }
+
+  private:
+    static std::uint64_t loadBe64(const std::uint8_t* p) {
+      std::uint64_t v = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      std::memcpy(&v, p, 8);
+      v = __builtin_bswap64(v);
+#else
+      for (int i = 0; i < 8; ++i) {
+        v = (v << 8) | p[i];
+      }
+#endif
+      return v;
+    }
+
+    const std::uint8_t* m_ip;
+    const std::uint8_t* m_end;
+    std::uint64_t m_bits = 0;
+    std::uint32_t m_count = 0;
+    std::uint32_t m_padBytes = 0;
+  };
+
+  /**
+   * Table-driven canonical decoder rebuilt from code lengths.
+   *
+   * The next kTableBits bits index a primary table that resolves every
+   * code of up to kTableBits bits in one lookup. Longer codes land on an
+   * entry pointing to a secondary table indexed by their remaining bits.
+   * Entry: symbol or secondary offset (bits 0-15), bits to consume or
+   * secondary index width (16-20), secondary flag (31).
+   */
+  class HuffmanDecoder {
+  public:
+    static constexpr std::uint32_t kTableBits = 11;
+
+    // false unless the lengths form a complete code (or a single symbol
+    // of length 1, which then decodes from any bit) over at most
+    // kHuffMaxSymbols symbols
+    bool init(const std::uint8_t* lengths, std::size_t count);
+
+    std::uint32_t maxLength() const { return m_maxLength; }
+
+    // Decode one symbol; br must hold at least maxLength() bits
+    std::uint32_t decode(HuffmanBitReader& br) const {
+      std::uint32_t e = m_table[br.peek(kTableBits)];
+      if ((e & kSubTableFlag) != 0) {
+        br.skip(kTableBits);
+        const std::uint32_t width = (e >> 16) & 0x1Fu;
+        e = m_table[(e & 0xFFFFu) + br.peek(width)];
+      }
+      br.skip((e >> 16) & 0x1Fu);
+      return e & 0xFFFFu;
+    }
+
+  private:
+    static constexpr std::uint32_t kSubTableFlag = 0x80000000u;
+    // A secondary table of width w holds 2^w entries and serves at least
+    // w + 1 codes of a complete code, so all of them fit in 4 per symbol
+    static constexpr std::size_t kTableSize =
+        (std::size_t(1) << kTableBits) + 4 * kHuffMaxSymbols;
+
+    std::uint32_t m_table[kTableSize]; // primary, then secondaries
+    std::uint32_t m_maxLength = 0;
+  };
+
+} // namespace CompressionLib
+
+#endif
@@ -0,0 +1,559 @@
+#include "compress/Lib/CompressionLib/Lzh.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/Histogram.hpp"
+#include "compress/Lib/CompressionLib/HuffmanCode.hpp"
+#include "compress/Lib/CompressionLib/MatchFinder.hpp"
+
+namespace CompressionLib {
+
+namespace {
+
+constexpr std::uint32_t kMinMatch   = 3;
+constexpr std::uint32_t kMaxMatch   = 1u << 16;
+// Matches this long are taken without looking one byte further
+constexpr std::uint32_t kNiceLength = 128;
+// A 3-byte match further back than this codes larger than its literals
+constexpr std::uint32_t kFarMinMatch = 4096;
+
+// Value codes: 16 direct codes, then two per power of two up to 2^29,
+// which covers every run, length and offset a block can hold
+constexpr std::uint32_t kDirectCodes = 16;
+constexpr std::size_t   kValueCodes  = 64;
+
+constexpr std::uint32_t kCodeLimit = kHuffMinLengthLimit;
+
+// Literal modes
+constexpr std::uint8_t kRawLiterals     = 0;
+constexpr std::uint8_t kHuffmanLiterals = 1;
+
+// Worst case per sequence: three codes and extra bits of up to 25 bits
+// for runs and offsets (blocks <= 2^26) and 15 for lengths
+constexpr std::size_t kMaxSequenceBytes = (3 * kHuffMaxCodeLength + 25 + 15 + 25 + 7) / 8;
+
+// Code-length table: mode byte, varint count, up to 128 packed bytes
+constexpr std::size_t kMaxTableBytes = 1 + 2 + 128;
+
+struct Sequence {
+  std::uint32_t literals; // literals before the match
+  std::uint32_t length;
+  std::uint32_t offset;
+};
+
+// ---------- Varint helpers ----------
+
+// LEB128: 7 value bits per byte, high bit set on all but the last byte
+void putVarint(std::pmr::vector<std::uint8_t>& out, std::uint64_t v) {
+  while (v >= 0x80u) {
+    out.push_back(static_cast<std::uint8_t>((v & 0x7Fu) | 0x80u));
+    v >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(v));
+}
+
+bool getVarint(const std::uint8_t*& ip,
+               const std::uint8_t* iend,
+               std::uint64_t& v) {
+  v = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (ip >= iend) {
+      return false;
+    }
+    const std::uint8_t b = *ip++;
+    v |= static_cast<std::uint64_t>(b & 0x7Fu) << shift;
+    if ((b & 0x80u) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ---------- Value codes ----------
+
+std::uint32_t floorLog2(std::uint32_t v) {
+#if defined(__GNUC__)
+  return 31u - static_cast<std::uint32_t>(__builtin_clz(v));
+#else
+  std::uint32_t k = 0;
+  while (v >>= 1) {
+    ++k;
+  }
+  return k;
+#endif
+}
+
+// Extra bits that follow a code, and the smallest value it stands for
+inline std::uint32_t extraBits(std::uint32_t code) {
+  return (code < kDirectCodes) ? 0 : (code - kDirectCodes) / 2 + 3;
+}
+
+inline std::uint32_t valueBase(std::uint32_t code) {
+  return (code < kDirectCodes) ? code : (2u | (code & 1u)) << extraBits(code);
+}
+
+inline std::uint32_t valueCode(std::uint32_t v) {
+  if (v < kDirectCodes) {
+    return v;
+  }
+  // v has k + 1 bits: the code keeps the top two, extra bits the rest
+  const std::uint32_t k = floorLog2(v);
+  return kDirectCodes + 2 * (k - 4) + ((v >> (k - 1)) & 1u);
+}
+
+void putValue(HuffmanBitWriter& bw, const HuffmanEncoder& enc, std::uint32_t v) {
+  const std::uint32_t code = valueCode(v);
+  enc.encode(bw, code);
+  const std::uint32_t bits = extraBits(code);
+  if (bits > 0) {
+    bw.put(v - valueBase(code), bits);
+  }
+  bw.flush();
+}
+
+// Needs the reader refilled; reads at most 15 + 26 bits
+inline std::uint32_t getValue(HuffmanBitReader& br, const HuffmanDecoder& dec) {
+  const std::uint32_t code = dec.decode(br);
+  const std::uint32_t bits = extraBits(code);
+  std::uint32_t v = valueBase(code);
+  if (bits > 0) {
+    v += br.peek(bits);
+    br.skip(bits);
+  }
+  return v;
+}
+
+// ---------- Parser ----------
+
+// Greedy / lazy parse of one block with a hash-chain finder, as the LZSS
+// encoder does. Lazy first looks one byte ahead: if the match starting at
+// pos+1 is longer, pos becomes a literal and that match is used instead.
+void parseBlock(const std::uint8_t* buf,
+                std::size_t n,
+                const LzhOptions& options,
+                Arena& scratch,
+                std::pmr::vector<std::uint8_t>& literals,
+                std::pmr::vector<Sequence>& sequences) {
+  HashChainMatchFinder finder(n, options.chainDepth, &scratch);
+
+  auto findAt = [&](std::size_t p) {
+    const std::size_t maxLen = std::min<std::size_t>(kMaxMatch, n - p);
+    LzMatch m;
+    if (maxLen >= HashChainMatchFinder::kHashBytes) {
+      m = finder.find(buf, static_cast<std::uint32_t>(p),
+                      static_cast<std::uint32_t>(maxLen), kMinMatch);
+      if (m.length == kMinMatch && m.offset > kFarMinMatch) {
+        m.length = 0;
+      }
+    }
+    return m;
+  };
+  auto insertAt = [&](std::size_t p) {
+    if (p + HashChainMatchFinder::kHashBytes <= n) {
+      finder.insert(buf, static_cast<std::uint32_t>(p));
+    }
+  };
+
+  std::size_t pos = 0;
+  std::size_t runStart = 0;
+  LzMatch best;
+  bool haveBest = false; // best already holds the match at pos
+  while (pos < n) {
+    if (!haveBest) {
+      best = findAt(pos);
+    }
+    haveBest = false;
+
+    insertAt(pos);
+    if (best.length == 0) {
+      ++pos;
+      continue;
+    }
+
+    if (options.lazy && best.length < kNiceLength && pos + 1 < n) {
+      const LzMatch next = findAt(pos + 1);
+      if (next.length > best.length) {
+        // Deferring by one literal buys a longer match
+        ++pos;
+        best = next;
+        haveBest = true;
+        continue;
+      }
+    }
+
+    literals.insert(literals.end(), buf + runStart, buf + pos);
+    sequences.push_back(Sequence{static_cast<std::uint32_t>(pos - runStart),
+                                 best.length, best.offset});
+
+    // Keep the chains complete for every byte the match covers
+    const std::size_t end = pos + best.length;
+    for (++pos; pos < end; ++pos) {
+      insertAt(pos);
+    }
+    runStart = pos;
+  }
+  literals.insert(literals.end(), buf + runStart, buf + n);
+}
+
+// ---------- Block encoder ----------
+
+// Code lengths for a histogram, appended to out as a table
+void buildCode(const std::uint64_t* freqs,
+               std::size_t count,
+               std::pmr::vector<std::uint8_t>& out,
+               HuffmanEncoder& enc) {
+  std::uint8_t lengths[256];
+  huffmanCodeLengths(freqs, count, kCodeLimit, lengths);
+  huffmanWriteLengths(out, lengths, count);
+  enc.init(lengths, count);
+}
+
+// Code data[0..n) into 'payload', all from the worker's scratch arena.
+// Every sequence covers at least kMinMatch bytes, which bounds the
+// buffers, and the payload is sized once the parse is known.
+void encodeBlock(const std::uint8_t* data,
+                 std::size_t n,
+                 const LzhOptions& options,
+                 Arena& scratch,
+                 std::pmr::vector<std::uint8_t>& payload) {
+  std::pmr::vector<std::uint8_t> literals(&scratch);
+  std::pmr::vector<Sequence> sequences(&scratch);
+  literals.reserve(n);
+  sequences.reserve(n / kMinMatch + 1);
+  parseBlock(data, n, options, scratch, literals, sequences);
+
+  // Two varints, the literals with their mode and table, three tables,
+  // the sequences and the bit writers' slack
+  payload.reserve(2 * 10 + 1 + kMaxTableBytes + 10 + literals.size() + 8 +
+                  3 * kMaxTableBytes + sequences.size() * kMaxSequenceBytes + 8);
+  putVarint(payload, sequences.size());
+  putVarint(payload, literals.size());
+
+  // ----- Literals: Huffman coded unless that does not pay -----
+  std::uint64_t litFreqs[256];
+  histogramCount(literals.data(), literals.size(), litFreqs);
+  std::pmr::vector<std::uint8_t> table(&scratch);
+  table.reserve(kMaxTableBytes);
+  HuffmanEncoder litEnc;
+  buildCode(litFreqs, 256, table, litEnc);
+  const std::uint64_t codedBytes = (litEnc.encodedBits(litFreqs) + 7) / 8;
+  if (literals.empty() || table.size() + 5 + codedBytes >= literals.size()) {
+    payload.push_back(kRawLiterals);
+    payload.insert(payload.end(), literals.begin(), literals.end());
+  } else {
+    payload.push_back(kHuffmanLiterals);
+    payload.insert(payload.end(), table.begin(), table.end());
+    putVarint(payload, codedBytes);
+    const std::size_t start = payload.size();
+    payload.resize(start + static_cast<std::size_t>(codedBytes) + 8);
+    HuffmanBitWriter bw(payload.data() + start);
+    std::size_t i = 0;
+    // Four codes of at most kCodeLimit bits fit between flushes
+    for (; literals.size() - i >= 4; i += 4) {
+      litEnc.encode(bw, literals[i]);
+      litEnc.encode(bw, literals[i + 1]);
+      litEnc.encode(bw, literals[i + 2]);
+      litEnc.encode(bw, literals[i + 3]);
+      bw.flush();
+    }
+    for (; i < literals.size(); ++i) {
+      litEnc.encode(bw, literals[i]);
+      bw.flush();
+    }
+    payload.resize(start + bw.finish());
+  }
+
+  if (sequences.empty()) {
+    return;
+  }
+
+  // ----- Sequences: one code per field -----
+  std::uint64_t runFreqs[kValueCodes] = {};
+  std::uint64_t lengthFreqs[kValueCodes] = {};
+  std::uint64_t offsetFreqs[kValueCodes] = {};
+  for (const Sequence& s : sequences) {
+    ++runFreqs[valueCode(s.literals)];
+    ++lengthFreqs[valueCode(s.length - kMinMatch)];
+    ++offsetFreqs[valueCode(s.offset - 1)];
+  }
+  HuffmanEncoder runEnc;
+  HuffmanEncoder lengthEnc;
+  HuffmanEncoder offsetEnc;
+  buildCode(runFreqs, kValueCodes, payload, runEnc);
+  buildCode(lengthFreqs, kValueCodes, payload, lengthEnc);
+  buildCode(offsetFreqs, kValueCodes, payload, offsetEnc);
+
+  const std::size_t start = payload.size();
+  payload.resize(start + sequences.size() * kMaxSequenceBytes + 8);
+  HuffmanBitWriter bw(payload.data() + start);
+  for (const Sequence& s : sequences) {
+    putValue(bw, runEnc, s.literals);
+    putValue(bw, lengthEnc, s.length - kMinMatch);
+    putValue(bw, offsetEnc, s.offset - 1);
+  }
+  payload.resize(start + bw.finish());
+}
+
+// ---------- Block decoder ----------
+
+// Copy a match of 'len' bytes from op - off to op. Wide copies may write
+// up to 16 bytes past op + len, so they stop 16 bytes short of 'limit'
+// (the end of this block's output; the next block belongs to another
+// thread).
+inline void copyMatch(std::uint8_t* op,
+                      std::size_t off,
+                      std::size_t len,
+                      const std::uint8_t* limit) {
+  const std::uint8_t* match = op - off;
+  std::uint8_t* const end = op + len;
+  if (off >= 16 && limit - end >= 16) {
+    do {
+      std::memcpy(op, match, 16);
+      op += 16;
+      match += 16;
+    } while (op < end);
+    return;
+  }
+  // Short period (runs) or near the end: byte at a time
+  while (op < end) {
+    *op++ = *match++;
+  }
+}
+
+// Read one code-length table and build its decoder
+bool readCode(const std::uint8_t*& ip,
+              const std::uint8_t* iend,
+              std::size_t count,
+              HuffmanDecoder& dec) {
+  std::uint8_t lengths[256];
+  return huffmanReadLengths(ip, iend, lengths, count) && dec.init(lengths, count);
+}
+
+template <unsigned K>
+void decodeLiterals(const HuffmanDecoder& dec,
+                    HuffmanBitReader& br,
+                    std::uint8_t* op,
+                    std::size_t n) {
+  std::size_t i = 0;
+  for (; n - i >= K; i += K) {
+    br.refill();
+    for (unsigned k = 0; k < K; ++k) {
+      op[i + k] = static_cast<std::uint8_t>(dec.decode(br));
+    }
+  }
+  for (; i < n; ++i) {
+    br.refill();
+    op[i] = static_cast<std::uint8_t>(dec.decode(br));
+  }
+}
+
+// Decode one payload into op[0..n)
+bool decodeBlock(const std::uint8_t* ip,
+                 const std::uint8_t* iend,
+                 std::uint8_t* op,
+                 std::size_t n,
+                 Arena& scratch) {
+  std::uint64_t sequenceCount = 0;
+  std::uint64_t literalCount = 0;
+  if (!getVarint(ip, iend, sequenceCount) || !getVarint(ip, iend, literalCount) ||
+      literalCount > n || sequenceCount > (n - literalCount) / kMinMatch ||
+      ip >= iend) {
+    return false;
+  }
+
+  // ----- Literals -----
+  const std::uint8_t mode = *ip++;
+  const std::uint8_t* lit = nullptr;
+  std::pmr::vector<std::uint8_t> litBuf(&scratch);
+  if (mode == kRawLiterals) {
+    if (static_cast<std::uint64_t>(iend - ip) < literalCount) {
+      return false;
+    }
+    lit = ip;
+    ip += literalCount;
+  } else if (mode == kHuffmanLiterals) {
+    // Decoder tables come from scratch: the calling thread may be a
+    // component thread with a small stack
+    HuffmanDecoder& litDec = *new (scratch.alloc<HuffmanDecoder>(1)) HuffmanDecoder;
+    std::uint64_t codedBytes = 0;
+    if (!readCode(ip, iend, 256, litDec) || !getVarint(ip, iend, codedBytes) ||
+        codedBytes > static_cast<std::uint64_t>(iend - ip)) {
+      return false;
+    }
+    litBuf.resize(static_cast<std::size_t>(literalCount));
+    HuffmanBitReader br(ip, ip + codedBytes);
+    // The reader holds 56 bits after a refill
+    if (litDec.maxLength() <= 14) {
+      decodeLiterals<4>(litDec, br, litBuf.data(), litBuf.size());
+    } else {
+      decodeLiterals<3>(litDec, br, litBuf.data(), litBuf.size());
+    }
+    if (br.overrun()) {
+      return false;
+    }
+    lit = litBuf.data();
+    ip += codedBytes;
+  } else {
+    return false;
+  }
+  const std::uint8_t* const litEnd = lit + literalCount;
+
+  // ----- Sequences -----
+  std::uint8_t* const begin = op;
+  std::uint8_t* const end = op + n;
+  if (sequenceCount > 0) {
+    HuffmanDecoder* decoders = new (scratch.alloc<HuffmanDecoder>(3)) HuffmanDecoder[3];
+    HuffmanDecoder& runDec = decoders[0];
+    HuffmanDecoder& lengthDec = decoders[1];
+    HuffmanDecoder& offsetDec = decoders[2];
+    if (!readCode(ip, iend, kValueCodes, runDec) ||
+        !readCode(ip, iend, kValueCodes, lengthDec) ||
+        !readCode(ip, iend, kValueCodes, offsetDec)) {
+      return false;
+    }
+
+    HuffmanBitReader br(ip, iend);
+    for (std::uint64_t s = 0; s < sequenceCount; ++s) {
+      br.refill();
+      const std::uint32_t run = getValue(br, runDec);
+      br.refill();
+      const std::uint32_t length = getValue(br, lengthDec) + kMinMatch;
+      br.refill();
+      const std::uint32_t offset = getValue(br, offsetDec) + 1;
+
+      if (run > static_cast<std::size_t>(litEnd - lit) ||
+          run > static_cast<std::size_t>(end - op)) {
+        return false;
+      }
+      std::memcpy(op, lit, run);
+      op += run;
+      lit += run;
+      if (offset > static_cast<std::size_t>(op - begin) ||
+          length > static_cast<std::size_t>(end - op)) {
+        return false;
+      }
+      copyMatch(op, offset, length, end);
+      op += length;
+    }
+    if (br.overrun()) {
+      return false;
+    }
+  } else if (ip != iend) {
+    return false;
+  }
+
+  // ----- Trailing literals -----
+  const auto rest = static_cast<std::size_t>(litEnd - lit);
+  if (rest != static_cast<std::size_t>(end - op)) {
+    return false;
+  }
+  std::memcpy(op, lit, rest);
+  return true;
+}
+
+// Scratch to code a block of n bytes: its finder, literals and
+// sequences, and its payload when every sequence is a minimal match
+// (typical data needs far less)
+std::size_t blockScratchBytes(std::size_t n) {
+  const std::size_t sequences = n / kMinMatch + 1;
+  return HashChainMatchFinder::memoryBytes(n) + n +
+         sequences * sizeof(Sequence) +
+         sequences * kMaxSequenceBytes + 4 * kMaxTableBytes +
+         4 * sizeof(HuffmanDecoder) + 1024;
+}
+
+} // namespace
+
+// -------------------- Public API: levels --------------------
+
+LzhOptions lzhOptionsForLevel(int level) {
+  struct Preset {
+    bool lazy;
+    std::uint32_t depth;
+    std::uint32_t blockSize;
+  };
+  constexpr std::uint32_t kK = 1024;
+  constexpr std::uint32_t kM = 1024 * kK;
+  static const Preset kPresets[kMaxLevel] = {
+    {false,    4, 256 * kK},  // 1
+    {false,    8, 512 * kK},  // 2
+    {true,     8,   1 * kM},  // 3
+    {true,    16,   1 * kM},  // 4
+    {true,    24,   1 * kM},  // 5
+    {true,    32,   1 * kM},  // 6 (default)
+    {true,    48,   2 * kM},  // 7
+    {true,    64,   4 * kM},  // 8
+    {true,    96,   8 * kM},  // 9
+    {true,   128,   8 * kM},  // 10
+    {true,   256,  16 * kM},  // 11
+    {true,   512,  16 * kM},  // 12
+  };
+
+  if (level < kMinLevel) level = kMinLevel;
+  if (level > kMaxLevel) level = kMaxLevel;
+
+  const Preset& p = kPresets[level - 1];
+  LzhOptions o;
+  o.lazy       = p.lazy;
+  o.chainDepth = p.depth;
+  o.blockSize  = p.blockSize;
+  return o;
+}
+
+// -------------------- Public API: container blocks --------------------
+
+std::uint32_t LzhBlockCodec::blockSize() const {
+  return std::min(std::max(m_options.blockSize, kLzhMinBlockSize), kLzhMaxBlockSize);
+}
+
+std::size_t LzhBlockCodec::scratchBytes(std::size_t n) const {
+  return blockScratchBytes(n);
+}
+
+bool LzhBlockCodec::encodeBlock(const std::uint8_t* in,
+                                std::size_t n,
+                                Arena& scratch,
+                                std::pmr::vector<std::uint8_t>& out) const {
+  CompressionLib::encodeBlock(in, n, m_options, scratch, out);
+  return true;
+}
+
+bool LzhBlockCodec::decodeBlock(const std::uint8_t* in,
+                                std::size_t size,
+                                std::uint8_t* out,
+                                std::size_t n,
+                                Arena& scratch) const {
+  return CompressionLib::decodeBlock(in, in + size, out, n, scratch);
+}
+
+// -------------------- Codec registration --------------------
+
+namespace {
+
+class LzhCodec final : public Codec {
+public:
+  Algorithm algorithm() const override { return Algorithm::LZH; }
+  const char* name() const override { return "LZH"; }
+  const char* extension() const override { return ".lzh"; }
+  CodecCapabilities capabilities() const override {
+    return kContainerCodecCapabilities;
+  }
+
+  BlockCodec* makeBlockCodec(int level, void* storage) const override {
+    static_assert(sizeof(LzhBlockCodec) <= kBlockCodecStorage);
+    return new (storage) LzhBlockCodec(lzhOptionsForLevel(level));
+  }
+};
+
+const LzhCodec kLzhCodec;
+
+} // namespace
+
+const CodecRegistration lzhCodecRegistration(kLzhCodec);
+
+} // namespace CompressionLib
@@ -0,0 +1,78 @@
+#ifndef COMPRESSION_LIB_LZH_HPP
+#define COMPRESSION_LIB_LZH_HPP
+
+#include <cstdint>
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
+
+namespace CompressionLib {
+
+  // LZ77 string matching followed by Huffman coding of the tokens, the
+  // same two stages as DEFLATE. LZSS stores literals, lengths and offsets
+  // as plain bytes; here each kind gets its own code fitted to the block.
+  //
+  // Each container block (see Container.hpp) is coded on its own and
+  // never matches into earlier blocks. A block is parsed into sequences,
+  // each a run of literals followed by one match; literals after the
+  // last match end the block. Payload:
+  //   varint sequence count, varint literal count,
+  //   literal mode byte: 0 = raw bytes, 1 = code-length table (see
+  //     huffmanWriteLengths) and varint stream size, then the literals,
+  //   if there are sequences: code-length tables for literal-run,
+  //     match-length and offset codes, then the sequence bitstream, which
+  //     holds per sequence the literal-run, match-length and offset codes,
+  //     each followed by its extra bits.
+  // Runs, match length - 3 and offset - 1 are coded as a value v: codes
+  // 0..15 are v itself, then two codes per power of two, each followed
+  // by the low bits of v. Bitstreams are MSB-first.
+  constexpr std::uint32_t kLzhMinBlockSize     = 64 * 1024;
+  constexpr std::uint32_t kLzhMaxBlockSize     = 64 * 1024 * 1024;
+  constexpr std::uint32_t kLzhDefaultBlockSize = 1024 * 1024;
+
+  struct LzhOptions {
+    // Max hash-chain candidates examined per position. Higher finds
+    // longer matches (better ratio) at the cost of speed.
+    std::uint32_t chainDepth = 32;
+    // Look one byte ahead for a longer match before taking one
+    bool lazy = true;
+    // Input bytes per block, clamped to [kLzhMinBlockSize,
+    // kLzhMaxBlockSize]. Also the match window.
+    std::uint32_t blockSize = kLzhDefaultBlockSize;
+  };
+
+  // Options for a compression level (see CompressionLib.hpp); out-of-range
+  // levels are clamped. Larger blocks mean a larger match window and
+  // roughly 6x the block size in memory per thread.
+  //   1-2   greedy, chain depth 4..8,     256 / 512 KiB blocks
+  //   3-6   lazy,   chain depth 8..32,    1 MiB blocks (6 = LzhOptions{})
+  //   7-10  lazy,   chain depth 48..128,  2..8 MiB blocks
+  //   11-12 lazy,   chain depth 256 / 512, 16 MiB blocks
+  LzhOptions lzhOptionsForLevel(int level);
+
+  // Container blocks hold one payload as above; there are no codec
+  // parameters
+  class LzhBlockCodec final : public BlockCodec {
+  public:
+    explicit LzhBlockCodec(const LzhOptions& options = LzhOptions{})
+      : m_options(options) {}
+
+    std::uint32_t blockSize() const override;
+    std::size_t scratchBytes(std::size_t n) const override;
+    bool encodeBlock(const std::uint8_t* in,
+                     std::size_t n,
+                     Arena& scratch,
+                     std::pmr::vector<std::uint8_t>& out) const override;
+    bool decodeBlock(const std::uint8_t* in,
+                     std::size_t size,
+                     std::uint8_t* out,
+                     std::size_t n,
+                     Arena& scratch) const override;
+
+  private:
+    LzhOptions m_options;
+  };
+
+} // namespace CompressionLib
+
+#endif
@@ -1,8 +1,15 @@
 #include "compress/Lib/CompressionLib/Lzss.hpp"
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/MatchFinder.hpp"
+#include "compress/Lib/CompressionLib/MatchLength.hpp"
 
 #include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <vector>
+#include <istream>
+#include <new>
+#include <optional>
+#include <ostream>
 
 namespace CompressionLib {
 
@@ -12,152 +19,578 @@ struct Params {
   std::size_t windowSize  = 4096; // dictionary size
   std::size_t lookahead   = 18;   // max match length
   std::size_t minMatch    = 3;    // minimum useful match length
+  std::size_t chainDepth  = 32;   // match-finder candidates tried per position
+  std::size_t niceLength  = 18;   // matches this long are taken without further search
+  LzssParse parse = LzssParse::LAZY;
+  LzssFormat format = LzssFormat::V1;
 };
 
-struct Match {
-  std::size_t offset = 0;
-  std::size_t length = 0;
-};
+// LZS2 header: magic, u32 window, u16 minMatch, u32 maxMatch, u64 length
+constexpr char kV2Magic[4] = {'L', 'Z', 'S', '2'};
+constexpr std::size_t kV2HeaderSize = 4 + 4 + 2 + 4 + 8;
+constexpr std::size_t kV2MaxWindow = static_cast<std::size_t>(1) << 20;
+constexpr std::size_t kV2MaxMatch  = static_cast<std::size_t>(1) << 16;
+constexpr std::size_t kV2NiceLength = 256;
+
+// Positions per optimal-parse block. Bounds the DP tables; matches are
+// cut at block edges so each block is parsed independently.
+constexpr std::size_t kOptimalBlock = 32768;
+
+// File I/O granularity for the streaming decoder
+constexpr std::size_t kIoChunk = 64 * 1024;
 
-// Naive search for best match in previous window
-Match findBestMatch(const std::vector<std::uint8_t>& in,
-                    std::size_t pos,
-                    const Params& params) {
-  Match best;
-  if (pos == 0) {
-    return best;
+// ---------- Little-endian / varint helpers ----------
+
+void putLe(std::pmr::vector<std::uint8_t>& out, std::uint64_t v, std::size_t bytes) {
+  for (std::size_t i = 0; i < bytes; ++i) {
+    out.push_back(static_cast<std::uint8_t>((v >> (8 * i)) & 0xFFu));
   }
+}
+
+std::uint64_t getLe(const std::uint8_t* p, std::size_t bytes) {
+  std::uint64_t v = 0;
+  for (std::size_t i = 0; i < bytes; ++i) {
+    v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+  }
+  return v;
+}
+
+// LEB128: 7 value bits per byte, high bit set on all but the last byte
+void putVarint(std::pmr::vector<std::uint8_t>& out, std::uint32_t v) {
+  while (v >= 0x80u) {
+    out.push_back(static_cast<std::uint8_t>((v & 0x7Fu) | 0x80u));
+    v >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(v));
+}
 
-  const std::size_t n = in.size();
-  const std::size_t windowStart =
-      (pos > params.windowSize) ? (pos - params.windowSize) : 0;
-  const std::size_t maxLen =
-      (pos + params.lookahead <= n) ? params.lookahead : (n - pos);
+std::uint32_t varintSize(std::uint32_t v) {
+  std::uint32_t size = 1;
+  while (v >= 0x80u) {
+    v >>= 7;
+    ++size;
+  }
+  return size;
+}
 
-  for (std::size_t j = windowStart; j < pos; ++j) {
-    std::size_t k = 0;
-    while (k < maxLen && in[j + k] == in[pos + k]) {
-      ++k;
+// Returns false on truncated input or a value wider than 32 bits
+bool getVarint(const std::uint8_t*& ip,
+               const std::uint8_t* iend,
+               std::uint32_t& v) {
+  v = 0;
+  for (unsigned shift = 0; shift < 32; shift += 7) {
+    if (ip >= iend) {
+      return false;
     }
-    if (k > best.length) {
-      best.length = k;
-      best.offset = pos - j;
-      if (best.length == maxLen) {
-        break; // can't do better than maxLen
-      }
+    const std::uint8_t b = *ip++;
+    v |= static_cast<std::uint32_t>(b & 0x7Fu) << shift;
+    if ((b & 0x80u) == 0) {
+      return true;
     }
   }
+  return false;
+}
 
-  // Enforce minimum match length: otherwise treat as no match
-  if (best.length < params.minMatch) {
-    best.length = 0;
-    best.offset = 0;
-  }
+// ---------- Token cost model ----------
+
+// Token sizes in bits, including the token's flag bit
+constexpr std::uint32_t kLiteralBits = 1 + 8;
 
-  return best;
+std::uint32_t matchBits(const Params& params,
+                        std::uint32_t offset,
+                        std::uint32_t length) {
+  if (params.format == LzssFormat::V1) {
+    return 1 + 24; // u16 offset + u8 length
+  }
+  const auto extra = static_cast<std::uint32_t>(length - params.minMatch);
+  return 1 + 8 * (varintSize(extra) + varintSize(offset - 1));
 }
 
-// Core LZSS encoder: in -> out, returns true on success
-bool lzssCompressBuffer(const std::vector<std::uint8_t>& in,
-                        std::vector<std::uint8_t>& out,
-                        const Params& params) {
-  out.clear();
-  const std::size_t n = in.size();
-  std::size_t pos = 0;
+// Packs tokens into the .lzss layout: a flag byte in front of every group
+// of up to 8 tokens (bit i set = token i is a match), then the tokens.
+//   V1 match: u16 offset (LE), u8 length
+//   V2 match: varint (length - minMatch), varint (offset - 1)
+class TokenWriter {
+public:
+  TokenWriter(std::pmr::vector<std::uint8_t>& out, const Params& params)
+    : m_out(out), m_format(params.format), m_minMatch(params.minMatch) {}
+
+  void literal(std::uint8_t b) {
+    nextToken();
+    m_out.push_back(b);
+  }
 
-  while (pos < n) {
-    // Reserve flag byte (will fill after processing up to 8 tokens)
-    std::size_t flagIndex = out.size();
-    out.push_back(0);
-    std::uint8_t flags = 0;
+  void match(std::size_t offset, std::size_t length) {
+    nextToken();
+    m_out[m_flagIndex] |= static_cast<std::uint8_t>(1u << m_bit);
 
-    for (int bit = 0; bit < 8 && pos < n; ++bit) {
-      Match best = findBestMatch(in, pos, params);
+    if (m_format == LzssFormat::V2) {
+      putVarint(m_out, static_cast<std::uint32_t>(length - m_minMatch));
+      putVarint(m_out, static_cast<std::uint32_t>(offset - 1));
+      return;
+    }
 
-      if (best.length > 0) {
-        // Match token: flag bit = 1
-        flags |= static_cast<std::uint8_t>(1u << bit);
+    // offset as 16 bits (little-endian)
+    std::uint16_t off = static_cast<std::uint16_t>(offset);
+    m_out.push_back(static_cast<std::uint8_t>(off & 0xFFu));
+    m_out.push_back(static_cast<std::uint8_t>((off >> 8) & 0xFFu));
 
-        // offset as 16 bits (little-endian)
-        std::uint16_t off = static_cast<std::uint16_t>(best.offset);
-        std::uint8_t offLo = static_cast<std::uint8_t>(off & 0xFFu);
-        std::uint8_t offHi = static_cast<std::uint8_t>((off >> 8) & 0xFFu);
+    // length as 1 byte (assumes lookahead <= 255)
+    m_out.push_back(static_cast<std::uint8_t>(length));
+  }
 
-        // length as 1 byte (assumes lookahead <= 255)
-        std::uint8_t lenByte = static_cast<std::uint8_t>(best.length);
+private:
+  void nextToken() {
+    if (m_count == 8) {
+      // Reserve flag byte (filled in as the group's tokens arrive)
+      m_flagIndex = m_out.size();
+      m_out.push_back(0);
+      m_count = 0;
+    }
+    m_bit = m_count++;
+  }
 
-        out.push_back(offLo);
-        out.push_back(offHi);
-        out.push_back(lenByte);
+  std::pmr::vector<std::uint8_t>& m_out;
+  LzssFormat m_format;
+  std::size_t m_minMatch;
+  std::size_t m_flagIndex = 0;
+  unsigned m_count = 8;
+  unsigned m_bit = 0;
+};
 
-        pos += best.length;
-      } else {
-        // Literal token: flag bit = 0 (already 0)
-        out.push_back(in[pos]);
+// Greedy / lazy parse over a hash-chain finder. Greedy always takes the
+// longest match at the current position. Lazy first looks one byte ahead:
+// if the match starting at pos+1 is longer, it emits a literal for pos and
+// re-evaluates from pos+1 with that match in hand.
+void parseHashChain(const std::uint8_t* buf,
+                    std::size_t n,
+                    const Params& params,
+                    bool lazy,
+                    TokenWriter& tw,
+                    std::pmr::memory_resource* memory) {
+  HashChainMatchFinder finder(params.windowSize, params.chainDepth, memory);
+  const auto minMatch = static_cast<std::uint32_t>(params.minMatch);
+
+  auto findAt = [&](std::size_t p) {
+    const std::size_t maxLen =
+        (p + params.lookahead <= n) ? params.lookahead : (n - p);
+    LzMatch m;
+    if (maxLen >= HashChainMatchFinder::kHashBytes) {
+      m = finder.find(buf, static_cast<std::uint32_t>(p),
+                      static_cast<std::uint32_t>(maxLen), minMatch);
+    }
+    return m;
+  };
+  auto insertAt = [&](std::size_t p) {
+    if (p + HashChainMatchFinder::kHashBytes <= n) {
+      finder.insert(buf, static_cast<std::uint32_t>(p));
+    }
+  };
+
+  std::size_t pos = 0;
+  LzMatch best;
+  bool haveBest = false; // best already holds the match at pos
+  while (pos < n) {
+    if (!haveBest) {
+      best = findAt(pos);
+    }
+    haveBest = false;
+
+    if (best.length == 0) {
+      insertAt(pos);
+      tw.literal(buf[pos]);
+      ++pos;
+      continue;
+    }
+
+    insertAt(pos);
+    if (lazy && best.length < params.niceLength && pos + 1 < n) {
+      const LzMatch next = findAt(pos + 1);
+      if (next.length > best.length) {
+        // Deferring by one literal buys a longer match
+        tw.literal(buf[pos]);
         ++pos;
+        best = next;
+        haveBest = true;
+        continue;
       }
     }
 
-    // Now we know the flags for this group of up to 8 tokens
-    out[flagIndex] = flags;
-  }
+    tw.match(best.offset, best.length);
 
-  return true;
+    // Keep the chains complete for every byte the match covers
+    const std::size_t end = pos + best.length;
+    for (++pos; pos < end; ++pos) {
+      insertAt(pos);
+    }
+  }
 }
 
-// Core LZSS decoder: in -> out, returns true on success
-bool lzssDecompressBuffer(const std::vector<std::uint8_t>& in,
-                          std::vector<std::uint8_t>& out) {
-  out.clear();
-  const std::size_t n = in.size();
-  std::size_t pos = 0;
+// Optimal parse: for each block, enumerate every candidate match with a
+// binary-tree finder, then run a shortest-path DP over the block where
+// each edge costs the token's size in bits. The cheapest path is the
+// token sequence with the fewest output bytes.
+struct Step {
+  std::uint32_t cost = 0;   // bits to reach this position
+  std::uint32_t length = 0; // token ending here (1 = literal)
+  std::uint32_t offset = 0; // 0 for literals
+};
 
-  while (pos < n) {
-    // Need at least one byte for flags
-    std::uint8_t flags = in[pos++];
-    for (int bit = 0; bit < 8 && pos < n; ++bit) {
-      bool isMatch = ((flags >> bit) & 0x1u) != 0;
-
-      if (isMatch) {
-        // We need 3 bytes: offLo, offHi, len
-        if (pos + 2 >= n) {
-          // Not enough bytes for a complete match token
-          return false;
-        }
-        std::uint8_t offLo = in[pos++];
-        std::uint8_t offHi = in[pos++];
-        std::uint8_t lenByte = in[pos++];
+void parseOptimal(const std::uint8_t* buf,
+                  std::size_t n,
+                  const Params& params,
+                  TokenWriter& tw,
+                  std::pmr::memory_resource* memory) {
+  const auto minMatch = static_cast<std::uint32_t>(params.minMatch);
+  // The tree only compares up to niceLen bytes; longer matches are
+  // extended directly and taken outright, like LZMA's "fast bytes".
+  const auto niceLen = static_cast<std::uint32_t>(
+      (params.niceLength < params.lookahead) ? params.niceLength
+                                             : params.lookahead);
+
+  BinaryTreeMatchFinder finder(params.windowSize, params.chainDepth, memory);
+  std::pmr::vector<LzMatch> matches(niceLen, memory);
+  std::pmr::vector<Step> steps(kOptimalBlock + 1, memory);
+  std::pmr::vector<Step> path(memory);
+  path.reserve(kOptimalBlock);
+
+  const auto end = static_cast<std::uint32_t>(n);
+  for (std::size_t blockStart = 0; blockStart < n;) {
+    const std::size_t blockLen =
+        (n - blockStart < kOptimalBlock) ? (n - blockStart) : kOptimalBlock;
+
+    for (std::size_t i = 1; i <= blockLen; ++i) {
+      steps[i].cost = 0xFFFFFFFFu;
+    }
+    steps[0].cost = 0;
+    std::size_t skipTo = 0; // positions inside a taken long match
+
+    // Forward pass: relax the literal edge and every match edge out of i
+    for (std::size_t i = 0; i < blockLen; ++i) {
+      const auto pos = static_cast<std::uint32_t>(blockStart + i);
+      const std::size_t count = finder.findAndInsert(
+          buf, pos, end, niceLen, minMatch, matches.data());
+      if (i < skipTo) {
+        continue; // only keep the tree up to date
+      }
 
-        std::uint16_t off = static_cast<std::uint16_t>(
-            offLo | (static_cast<std::uint16_t>(offHi) << 8));
-        std::size_t length = lenByte;
+      const std::uint32_t here = steps[i].cost;
+      if (here + kLiteralBits < steps[i + 1].cost) {
+        steps[i + 1] = Step{here + kLiteralBits, 1, 0};
+      }
 
-        if (off == 0 || length == 0 || off > out.size()) {
-          // Invalid reference
-          return false;
+      const auto remaining = static_cast<std::uint32_t>(blockLen - i);
+      if (count > 0 && matches[count - 1].length == niceLen &&
+          remaining > niceLen) {
+        // Long match: extend it as far as allowed and commit to it
+        const LzMatch& m = matches[count - 1];
+        std::uint32_t limit = static_cast<std::uint32_t>(params.lookahead);
+        if (limit > remaining) limit = remaining;
+        const std::uint32_t len =
+            m.length + matchLength(buf + pos + m.length,
+                                   buf + pos + m.length - m.offset,
+                                   limit - m.length);
+        const std::uint32_t cost = here + matchBits(params, m.offset, len);
+        if (cost < steps[i + len].cost) {
+          steps[i + len] = Step{cost, len, m.offset};
         }
+        skipTo = i + len;
+        continue;
+      }
 
-        std::size_t start = out.size() - off;
-        for (std::size_t k = 0; k < length; ++k) {
-          // Overlap-safe: out grows as we push_back, but
-          // index start+k always < current out.size()
-          std::uint8_t b = out[start + k];
-          out.push_back(b);
+      // Any length up to a candidate's length is available at its offset
+      std::uint32_t len = minMatch;
+      for (std::size_t m = 0; m < count; ++m) {
+        std::uint32_t top = matches[m].length;
+        if (top > remaining) {
+          top = remaining;
         }
-      } else {
-        // Literal: need one byte
-        if (pos >= n) {
-          // Expecting literal but at end of input
-          return false;
+        for (; len <= top; ++len) {
+          const std::uint32_t cost =
+              here + matchBits(params, matches[m].offset, len);
+          if (cost < steps[i + len].cost) {
+            steps[i + len] = Step{cost, len, matches[m].offset};
+          }
         }
-        out.push_back(in[pos++]);
       }
     }
+
+    // Walk back from the block end, then emit tokens front to back
+    path.clear();
+    for (std::size_t i = blockLen; i > 0; i -= steps[i].length) {
+      path.push_back(steps[i]);
+    }
+    std::size_t pos = blockStart;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      if (it->offset == 0) {
+        tw.literal(buf[pos]);
+      } else {
+        tw.match(it->offset, it->length);
+      }
+      pos += it->length;
+    }
+    blockStart += blockLen;
+  }
+}
+
+// Bytes lzssEncode takes from its memory resource: finder and parse tables
+std::size_t encodeMemory(const Params& params) {
+  if (params.parse != LzssParse::OPTIMAL) {
+    return HashChainMatchFinder::memoryBytes(params.windowSize) + 256;
+  }
+  return BinaryTreeMatchFinder::memoryBytes(params.windowSize) +
+         (2 * kOptimalBlock + 1) * sizeof(Step) +
+         params.lookahead * sizeof(LzMatch) + 256;
+}
+
+// Core LZSS encoder: header (V2) then tokens for all of buf[0..n) into
+// 'out'. The finder and parse tables come from 'memory'.
+void lzssEncode(const std::uint8_t* buf,
+                std::size_t n,
+                const Params& params,
+                std::pmr::vector<std::uint8_t>& out,
+                std::pmr::memory_resource* memory) {
+  out.clear();
+  if (params.format == LzssFormat::V2) {
+    for (char c : kV2Magic) {
+      out.push_back(static_cast<std::uint8_t>(c));
+    }
+    putLe(out, params.windowSize, 4);
+    putLe(out, params.minMatch, 2);
+    putLe(out, params.lookahead, 4);
+    putLe(out, n, 8);
+  }
+  TokenWriter tw(out, params);
+
+  switch (params.parse) {
+    case LzssParse::OPTIMAL:
+      parseOptimal(buf, n, params, tw, memory);
+      break;
+    case LzssParse::LAZY:
+      parseHashChain(buf, n, params, true, tw, memory);
+      break;
+    case LzssParse::GREEDY:
+    default:
+      parseHashChain(buf, n, params, false, tw, memory);
+      break;
+  }
+}
+
+// ---------- Decoder ----------
+
+// Matches are copied in whole 16-byte chunks, so the output buffer must
+// have this many writable bytes past the decoded length.
+constexpr std::size_t kCopySlack = 16;
+
+// Worst-case bytes in one flag group (flag byte + 8 match tokens).
+// With at least this much input left, a group decodes without per-byte
+// input checks.
+constexpr std::size_t kV1MaxGroupBytes = 1 + 8 * 3;
+constexpr std::size_t kV2MaxGroupBytes = 1 + 8 * (5 + 5);
+
+struct StreamInfo {
+  bool v2 = false;
+  std::size_t headerSize = 0;
+  std::size_t windowSize = 0xFFFFu; // V1 offsets are 16-bit
+  std::size_t minMatch = 1;
+  std::size_t maxMatch = 0xFFu;     // V1 lengths are 8-bit
+  std::uint64_t outLen = 0;
+};
+
+// Copy a match of 'len' bytes from op - off to op. Needs kCopySlack bytes
+// of room past op + len; the overshoot is rewritten by later tokens.
+inline void copyMatch(std::uint8_t* op, std::size_t off, std::size_t len) {
+  const std::uint8_t* match = op - off;
+  std::uint8_t* const end = op + len;
+  if (off >= 16) {
+    // Source never overlaps the chunk being written
+    do {
+      std::memcpy(op, match, 16);
+      op += 16;
+      match += 16;
+    } while (op < end);
+  } else if (off >= 8) {
+    do {
+      std::memcpy(op, match, 8);
+      op += 8;
+      match += 8;
+    } while (op < end);
+  } else {
+    // Short period (runs): byte at a time so each byte sees the last
+    while (op < end) {
+      *op++ = *match++;
+    }
   }
+}
+
+bool isV2Header(const std::uint8_t* in, std::size_t n) {
+  return n >= kV2HeaderSize && in[0] == kV2Magic[0] &&
+         in[1] == kV2Magic[1] && in[2] == kV2Magic[2] &&
+         in[3] == kV2Magic[3];
+}
+
+// Fill 'info' from an LZS2 header; false if the parameters are unusable
+bool parseV2Header(const std::uint8_t* in, StreamInfo& info) {
+  info.v2 = true;
+  info.headerSize = kV2HeaderSize;
+  info.windowSize = static_cast<std::size_t>(getLe(in + 4, 4));
+  info.minMatch   = static_cast<std::size_t>(getLe(in + 8, 2));
+  info.maxMatch   = static_cast<std::size_t>(getLe(in + 10, 4));
+  info.outLen     = getLe(in + 14, 8);
+  return info.windowSize != 0 && info.windowSize <= kV2MaxWindow &&
+         info.minMatch != 0 && info.maxMatch >= info.minMatch &&
+         info.maxMatch <= kV2MaxMatch;
+}
 
+// Decode one flag group from ip into op, never writing past oend (plus
+// kCopySlack). 'lo' is the oldest output byte a match may reach back to.
+// A V1 stream has no length field, so a group cut short by the end of
+// input simply ends there.
+inline bool decodeGroup(const std::uint8_t*& ip,
+                        const std::uint8_t* iend,
+                        const std::uint8_t* lo,
+                        std::uint8_t*& op,
+                        std::uint8_t* oend,
+                        const StreamInfo& info) {
+  const std::size_t maxGroup = info.v2 ? kV2MaxGroupBytes : kV1MaxGroupBytes;
+  // Far from the input end every token is known to be in bounds
+  const bool checked = static_cast<std::size_t>(iend - ip) < maxGroup;
+  const std::uint8_t flags = *ip++;
+
+  for (int bit = 0; bit < 8 && op < oend; ++bit) {
+    if (checked && ip >= iend) {
+      // V2 must produce outLen bytes first; a V1 group is never empty
+      return !info.v2 && bit > 0;
+    }
+    if (((flags >> bit) & 0x1u) == 0) {
+      *op++ = *ip++;
+      continue;
+    }
+
+    std::size_t off = 0;
+    std::size_t length = 0;
+    if (info.v2) {
+      std::uint32_t extra = 0;
+      std::uint32_t offMinus1 = 0;
+      if (!getVarint(ip, iend, extra) || !getVarint(ip, iend, offMinus1)) {
+        return false;
+      }
+      length = info.minMatch + extra;
+      off = static_cast<std::size_t>(offMinus1) + 1;
+    } else {
+      if (checked && iend - ip < 3) {
+        return false; // not enough bytes for a complete match token
+      }
+      off = static_cast<std::size_t>(ip[0]) |
+            (static_cast<std::size_t>(ip[1]) << 8);
+      length = ip[2];
+      ip += 3;
+    }
+
+    if (off == 0 || length == 0 || length > info.maxMatch ||
+        off > info.windowSize ||
+        off > static_cast<std::size_t>(op - lo) ||
+        length > static_cast<std::size_t>(oend - op)) {
+      return false; // invalid reference
+    }
+    copyMatch(op, off, length);
+    op += length;
+  }
   return true;
 }
 
+// Decode the token stream [ip, iend) into exactly info.outLen bytes at
+// 'out', which must have kCopySlack spare bytes after outLen.
+bool decodeTokens(const std::uint8_t* ip,
+                  const std::uint8_t* iend,
+                  std::uint8_t* out,
+                  const StreamInfo& info) {
+  std::uint8_t* op = out;
+  std::uint8_t* const oend = out + info.outLen;
+
+  while (op < oend) {
+    if (ip >= iend || !decodeGroup(ip, iend, out, op, oend, info)) {
+      return false; // stream ended early or bad token
+    }
+  }
+
+  // V1 has no length field: the stream must end exactly with the output
+  return info.v2 || ip == iend;
+}
+
+// Streaming V1 decoder: src -> dst in bounded memory from the job arena.
+// Input is read in kIoChunk pieces; output is decoded into a buffer that
+// keeps one window of history and is flushed and slid forward as it fills.
+// A V1 stream has no length field; it ends with the input.
+bool lzssDecompressStream(std::istream& src,
+                          std::ostream& dst,
+                          Context& ctx,
+                          std::uint64_t& outLen) {
+  Arena& arena = ctx.job();
+  std::pmr::vector<std::uint8_t> inBuf(2 * kIoChunk, &arena);
+  const std::uint8_t* ip = inBuf.data();
+  const std::uint8_t* iend = inBuf.data();
+  bool eof = false;
+
+  // Keep at least 'want' bytes ahead of ip unless the input runs out
+  auto refill = [&](std::size_t want) {
+    const auto avail = static_cast<std::size_t>(iend - ip);
+    if (avail >= want || eof) {
+      return;
+    }
+    std::memmove(inBuf.data(), ip, avail);
+    src.read(reinterpret_cast<char*>(inBuf.data() + avail),
+             static_cast<std::streamsize>(inBuf.size() - avail));
+    const auto got = static_cast<std::size_t>(src.gcount());
+    eof = (got < inBuf.size() - avail);
+    ip = inBuf.data();
+    iend = inBuf.data() + avail + got;
+  };
+
+  const StreamInfo info;
+  // No group expands past this, so one always fits once this much is free
+  const std::size_t groupOut = 8 * info.maxMatch;
+
+  std::pmr::vector<std::uint8_t> hist(info.windowSize + groupOut + kIoChunk +
+                                      kCopySlack, &arena);
+  std::uint8_t* const histEnd = hist.data() + hist.size() - kCopySlack;
+  std::uint8_t* op = hist.data();
+  std::uint8_t* written = hist.data(); // [written, op) not yet in dst
+  std::uint64_t slid = 0;              // bytes dropped off the front
+
+  auto flush = [&]() {
+    dst.write(reinterpret_cast<const char*>(written),
+              static_cast<std::streamsize>(op - written));
+    written = op;
+  };
+
+  for (;;) {
+    refill(kV1MaxGroupBytes);
+    if (ip >= iend) {
+      break;
+    }
+
+    if (static_cast<std::size_t>(histEnd - op) < groupOut) {
+      // Out of room: write what is decoded, keep one window as history
+      flush();
+      const std::size_t delta =
+          static_cast<std::size_t>(op - hist.data()) - info.windowSize;
+      std::memmove(hist.data(), hist.data() + delta, info.windowSize);
+      op -= delta;
+      written = op;
+      slid += delta;
+    }
+
+    if (!decodeGroup(ip, iend, hist.data(), op, histEnd, info)) {
+      return false;
+    }
+  }
+
+  flush();
+  outLen = slid + static_cast<std::uint64_t>(op - hist.data());
+  return static_cast<bool>(dst);
+}
+
 // Helper to choose an output path from an input .lzss file
 std::string deriveOutputPath(const std::string& inPath) {
   const std::string algoExt = ".lzss";
@@ -186,120 +619,201 @@ std::string deriveOutputPath(const std::string& inPath) {
   return base + "_DC" + origExt;               // ".../dickens_DC.txt"
 }
 
+// Encoder parameters for the public options
+Params paramsFor(const LzssOptions& options) {
+  Params params;
+  params.windowSize = 4096;
+  params.lookahead  = 18;
+  params.minMatch   = 3;
+  params.niceLength = 18;
+  params.chainDepth = options.chainDepth;
+  params.parse      = options.parse;
+  params.format     = options.format;
+  if (options.format == LzssFormat::V2) {
+    // Clamp to what the LZS2 header and decoder accept
+    params.windowSize = (options.windowSize == 0) ? 1
+                      : (options.windowSize > kV2MaxWindow) ? kV2MaxWindow
+                      : options.windowSize;
+    params.lookahead  = (options.maxMatch < params.minMatch) ? params.minMatch
+                      : (options.maxMatch > kV2MaxMatch) ? kV2MaxMatch
+                      : options.maxMatch;
+    params.niceLength = kV2NiceLength;
+  }
+  return params;
+}
+
+// Room for a block of n bytes once coded. Tokens rarely cost more than a
+// third over the input; if they do the buffer just grows.
+std::size_t blockBound(std::size_t n) {
+  return n + n / 3 + kV2HeaderSize + 64;
+}
+
 } // namespace
 
-// -------------------- Public API: compress file --------------------
+// -------------------- Public API: levels --------------------
+
+LzssOptions lzssOptionsForLevel(int level) {
+  struct Preset {
+    LzssParse parse;
+    std::uint32_t depth;
+    LzssFormat format;
+    std::uint32_t window;
+  };
+  constexpr std::uint32_t kK = 1024;
+  static const Preset kPresets[kLzssMaxLevel] = {
+    {LzssParse::GREEDY,    4, LzssFormat::V1,    4 * kK},  // 1
+    {LzssParse::GREEDY,    8, LzssFormat::V1,    4 * kK},  // 2
+    {LzssParse::GREEDY,   16, LzssFormat::V1,    4 * kK},  // 3
+    {LzssParse::LAZY,     16, LzssFormat::V1,    4 * kK},  // 4
+    {LzssParse::LAZY,     32, LzssFormat::V1,    4 * kK},  // 5
+    {LzssParse::LAZY,     64, LzssFormat::V1,    4 * kK},  // 6 (default)
+    {LzssParse::LAZY,    128, LzssFormat::V2,  256 * kK},  // 7
+    {LzssParse::LAZY,    256, LzssFormat::V2, 1024 * kK},  // 8
+    {LzssParse::OPTIMAL,  16, LzssFormat::V2, 1024 * kK},  // 9
+    {LzssParse::OPTIMAL,  32, LzssFormat::V2, 1024 * kK},  // 10
+    {LzssParse::OPTIMAL,  64, LzssFormat::V2, 1024 * kK},  // 11
+    {LzssParse::OPTIMAL, 128, LzssFormat::V2, 1024 * kK},  // 12
+  };
+
+  if (level < kLzssMinLevel) level = kLzssMinLevel;
+  if (level > kLzssMaxLevel) level = kLzssMaxLevel;
+
+  const Preset& p = kPresets[level - 1];
+  LzssOptions o;
+  o.parse      = p.parse;
+  o.chainDepth = p.depth;
+  o.format     = p.format;
+  if (p.format == LzssFormat::V2) {
+    o.windowSize = p.window;
+    o.maxMatch   = 64 * kK;
+  }
+  return o;
+}
+
+// -------------------- Public API: decompress file --------------------
 
-Result lzssCompressFile(const std::string& inPath) {
+Result lzssDecompressFile(const std::string& inPath, Context* context) {
   Result r{};
+  std::optional<Context> temporary;
+  Context& ctx = (context != nullptr) ? *context : temporary.emplace();
+  ctx.reset();
 
-  // Open once to get size (for bytesIn)
-  std::ifstream sizeStream(inPath, std::ios::binary | std::ios::ate);
-  if (!sizeStream) {
+  std::ifstream src(inPath, std::ios::binary | std::ios::ate);
+  if (!src) {
     r.error = -1; // file open error
     return r;
   }
-  auto size = sizeStream.tellg();
-  sizeStream.close();
-
+  auto size = src.tellg();
   if (size < 0) {
     r.error = -1;
     return r;
   }
-
   r.bytesIn = static_cast<std::uint32_t>(size);
+  src.seekg(0, std::ios::beg);
 
-  // Read entire file into memory
-  std::ifstream in(inPath, std::ios::binary);
-  if (!in) {
-    r.error = -1;
-    return r;
-  }
-
-  std::vector<std::uint8_t> input;
-  input.assign(std::istreambuf_iterator<char>(in),
-               std::istreambuf_iterator<char>());
-  in.close();
-
-  // Compress
-  std::vector<std::uint8_t> output;
-  Params params;
-  params.windowSize = 4096;
-  params.lookahead  = 18;
-  params.minMatch   = 3;
-
-  bool ok = lzssCompressBuffer(input, output, params);
-  if (!ok) {
-    r.error = -3; // internal LZSS error
-    return r;
-  }
-
-  // Write to <inPath>.lzss
-  const std::string outPath = inPath + ".lzss";
+  // Choose output path
+  const std::string outPath = deriveOutputPath(inPath);
   std::ofstream dst(outPath, std::ios::binary | std::ios::trunc);
   if (!dst) {
     r.error = -2; // write error
     return r;
   }
-  if (!output.empty()) {
-    dst.write(reinterpret_cast<const char*>(output.data()),
-              static_cast<std::streamsize>(output.size()));
-  }
+
+  std::uint64_t outLen = 0;
+  const bool ok = lzssDecompressStream(src, dst, ctx, outLen);
   dst.close();
+  if (!ok) {
+    r.error = dst ? -3 : -2; // LZSS decode error (bad format, etc.)
+    return r;
+  }
 
-  r.bytesOut = static_cast<std::uint32_t>(output.size());
+  r.bytesOut = static_cast<std::uint32_t>(outLen);
   r.error    = 0;
   return r;
 }
 
-// -------------------- Public API: decompress file --------------------
+// -------------------- Public API: container blocks --------------------
 
-Result lzssDecompressFile(const std::string& inPath) {
-  Result r{};
+std::uint32_t LzssBlockCodec::blockSize() const {
+  return (m_options.blockSize < kLzssMinBlockSize) ? kLzssMinBlockSize
+       : (m_options.blockSize > kLzssMaxBlockSize) ? kLzssMaxBlockSize
+       : m_options.blockSize;
+}
 
-  // Read compressed file
-  std::ifstream in(inPath, std::ios::binary | std::ios::ate);
-  if (!in) {
-    r.error = -1; // file open error
-    return r;
+std::size_t LzssBlockCodec::scratchBytes(std::size_t n) const {
+  return encodeMemory(paramsFor(m_options)) + blockBound(n);
+}
+
+void LzssBlockCodec::writeParams(std::pmr::vector<std::uint8_t>& out) const {
+  out.push_back(static_cast<std::uint8_t>(m_options.format));
+}
+
+bool LzssBlockCodec::readParams(const std::uint8_t* params, std::size_t size) {
+  if (size != 1 || (params[0] != static_cast<std::uint8_t>(LzssFormat::V1) &&
+                    params[0] != static_cast<std::uint8_t>(LzssFormat::V2))) {
+    return false;
   }
-  auto size = in.tellg();
-  if (size < 0) {
-    r.error = -1;
-    return r;
+  m_options.format = static_cast<LzssFormat>(params[0]);
+  return true;
+}
+
+bool LzssBlockCodec::encodeBlock(const std::uint8_t* in,
+                                 std::size_t n,
+                                 Arena& scratch,
+                                 std::pmr::vector<std::uint8_t>& out) const {
+  out.reserve(blockBound(n));
+  lzssEncode(in, n, paramsFor(m_options), out, &scratch);
+  return true;
+}
+
+bool LzssBlockCodec::decodeBlock(const std::uint8_t* in,
+                                 std::size_t size,
+                                 std::uint8_t* out,
+                                 std::size_t n,
+                                 Arena& scratch) const {
+  (void)scratch;
+  static_assert(kCopySlack <= kBlockSlack, "match copies overrun the block slack");
+  // V1 has no header; the block table gives its length
+  StreamInfo info;
+  info.outLen = n;
+  if (m_options.format == LzssFormat::V2 &&
+      (!isV2Header(in, size) || !parseV2Header(in, info) || info.outLen != n)) {
+    return false;
   }
-  r.bytesIn = static_cast<std::uint32_t>(size);
-  in.seekg(0, std::ios::beg);
+  return decodeTokens(in + info.headerSize, in + size, out, info);
+}
 
-  std::vector<std::uint8_t> input;
-  input.assign(std::istreambuf_iterator<char>(in),
-               std::istreambuf_iterator<char>());
-  in.close();
+// -------------------- Codec registration --------------------
 
-  // Decompress
-  std::vector<std::uint8_t> output;
-  bool ok = lzssDecompressBuffer(input, output);
-  if (!ok) {
-    r.error = -3; // LZSS decode error (bad format, etc.)
-    return r;
+namespace {
+
+class LzssCodec final : public Codec {
+public:
+  Algorithm algorithm() const override { return Algorithm::LZSS; }
+  const char* name() const override { return "LZSS"; }
+  const char* extension() const override { return ".lzss"; }
+  CodecCapabilities capabilities() const override {
+    return kContainerCodecCapabilities;
   }
 
-  // Choose output path
-  const std::string outPath = deriveOutputPath(inPath);
-  std::ofstream dst(outPath, std::ios::binary | std::ios::trunc);
-  if (!dst) {
-    r.error = -2; // write error
-    return r;
+  // Large inputs are split into blocks coded on all cores
+  BlockCodec* makeBlockCodec(int level, void* storage) const override {
+    static_assert(sizeof(LzssBlockCodec) <= kBlockCodecStorage);
+    return new (storage) LzssBlockCodec(lzssOptionsForLevel(level));
   }
-  if (!output.empty()) {
-    dst.write(reinterpret_cast<const char*>(output.data()),
-              static_cast<std::streamsize>(output.size()));
+
+  // Headerless V1 files carry no magic, so they are only ever decoded
+  // here when the caller names LZSS
+  Result decompressFile(const std::string& path,
+                        Context* context) const override {
+    return lzssDecompressFile(path, context);
   }
-  dst.close();
+};
 
-  r.bytesOut = static_cast<std::uint32_t>(output.size());
-  r.error    = 0;
-  return r;
-}
+const LzssCodec kLzssCodec;
+
+} // namespace
+
+const CodecRegistration lzssCodecRegistration(kLzssCodec);
 
 } // namespace CompressionLib
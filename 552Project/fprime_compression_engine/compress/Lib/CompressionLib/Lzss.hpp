@@ -1,14 +1,98 @@
 #ifndef COMPRESSION_LIB_LZSS_HPP
 #define COMPRESSION_LIB_LZSS_HPP
 
+#include <cstdint>
 #include <string>
 #include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
 
 namespace CompressionLib {
 
-  Result lzssCompressFile(const std::string& inPath);
+  // How the encoder picks tokens. Every strategy writes the same token
+  // layout; they differ only in CPU time spent versus output size.
+  enum class LzssParse : std::uint8_t {
+    GREEDY  = 0,  // longest match at each position (hash-chain finder)
+    OPTIMAL = 1,  // max ratio: binary-tree finder + cost-based DP per block
+    LAZY    = 2   // greedy + one-step lookahead (hash-chain finder)
+  };
 
-  Result lzssDecompressFile(const std::string& inPath);
+  // Token layout written by the encoder:
+  //  V1: classic headerless .lzss, 4 KiB window, 3..18 byte matches,
+  //      match = u16 offset + u8 length
+  //  V2: "LZS2" header (u32 window, u16 minMatch, u32 maxMatch,
+  //      u64 original length), then match = varint (length - minMatch),
+  //      varint (offset - 1); windows up to 1 MiB, matches up to 64 KiB
+  enum class LzssFormat : std::uint8_t {
+    V1 = 1,
+    V2 = 2
+  };
+
+  // Container blocks (see below) hold at most this many input bytes
+  constexpr std::uint32_t kLzssMinBlockSize     = 64 * 1024;
+  constexpr std::uint32_t kLzssMaxBlockSize     = 64 * 1024 * 1024;
+  constexpr std::uint32_t kLzssDefaultBlockSize = 1024 * 1024;
+
+  struct LzssOptions {
+    // Max match-finder candidates examined per position (hash-chain links
+    // for GREEDY/LAZY, tree nodes for OPTIMAL). Higher finds longer
+    // matches (better ratio) at the cost of speed.
+    std::uint32_t chainDepth = 64;
+    LzssParse parse = LzssParse::LAZY;
+    LzssFormat format = LzssFormat::V1;
+    // V2 only (V1 is fixed at 4096 / 18)
+    std::uint32_t windowSize = 4096;
+    std::uint32_t maxMatch = 18;
+    // Input bytes per container block, clamped to [kLzssMinBlockSize,
+    // kLzssMaxBlockSize]
+    std::uint32_t blockSize = kLzssDefaultBlockSize;
+  };
+
+  // Compression levels: 1 = fastest ... 12 = smallest output.
+  //   1-3  greedy,  chain depth 4..16,    V1
+  //   4-6  lazy,    chain depth 16..64,   V1  (6 = default, same as LzssOptions{})
+  //   7-8  lazy,    chain depth 128..256, V2 with 256 KiB / 1 MiB window
+  //   9-12 optimal, tree depth 16..128,   V2 with 1 MiB window
+  constexpr int kLzssMinLevel     = 1;
+  constexpr int kLzssMaxLevel     = 12;
+  constexpr int kLzssDefaultLevel = 6;
+
+  // Options for a level; out-of-range levels are clamped.
+  LzssOptions lzssOptionsForLevel(int level);
+
+  // Decompress a headerless V1 .lzss file, the format releases before the
+  // container wrote. Streams through fixed-size chunks, so memory stays
+  // at O(window + chunk) whatever the file size. Working memory comes
+  // from 'ctx' (nullptr = a context for this call only).
+  Result lzssDecompressFile(const std::string& inPath,
+                            Context* ctx = nullptr);
+
+  // Container blocks (see Container.hpp): each is a complete V1 / V2
+  // token stream with no history from earlier blocks. The codec
+  // parameters are one byte, the format (LzssFormat), so V1 blocks need
+  // no guessing.
+  class LzssBlockCodec final : public BlockCodec {
+  public:
+    explicit LzssBlockCodec(const LzssOptions& options = LzssOptions{})
+      : m_options(options) {}
+
+    std::uint32_t blockSize() const override;
+    std::size_t scratchBytes(std::size_t n) const override;
+    void writeParams(std::pmr::vector<std::uint8_t>& out) const override;
+    bool readParams(const std::uint8_t* params, std::size_t size) override;
+    bool encodeBlock(const std::uint8_t* in,
+                     std::size_t n,
+                     Arena& scratch,
+                     std::pmr::vector<std::uint8_t>& out) const override;
+    bool decodeBlock(const std::uint8_t* in,
+                     std::size_t size,
+                     std::uint8_t* out,
+                     std::size_t n,
+                     Arena& scratch) const override;
+
+  private:
+    LzssOptions m_options;
+  };
   
 } // namespace CompressionLib
 
@@ -0,0 +1,253 @@
+#include "compress/Lib/CompressionLib/MatchFinder.hpp"
+#include "compress/Lib/CompressionLib/MatchLength.hpp"
+
+namespace CompressionLib {
+
+namespace {
+
+constexpr std::uint32_t kNil = 0xFFFFFFFFu;
+
+// Smallest power of two >= v (v >= 1)
+std::size_t roundUpPow2(std::size_t v) {
+  std::size_t p = 1;
+  while (p < v) {
+    p <<= 1;
+  }
+  return p;
+}
+
+std::uint32_t log2Pow2(std::size_t p) {
+  std::uint32_t bits = 0;
+  while ((static_cast<std::size_t>(1) << bits) < p) {
+    ++bits;
+  }
+  return bits;
+}
+
+std::uint32_t hashBitsFor(std::size_t ringSize) {
+  // ~1 hash bucket per window position, clamped to a sane table size
+  std::uint32_t hashBits = log2Pow2(ringSize);
+  if (hashBits < 15) hashBits = 15;
+  if (hashBits > 20) hashBits = 20;
+  return hashBits;
+}
+
+// Positions older than the slide fall out; the rest move down by delta
+void rebase(std::pmr::vector<std::uint32_t>& table, std::uint32_t delta) {
+  for (std::uint32_t& v : table) {
+    v = (v == kNil || v < delta) ? kNil : v - delta;
+  }
+}
+
+std::pmr::memory_resource* orHeap(std::pmr::memory_resource* memory) {
+  return memory != nullptr ? memory : std::pmr::new_delete_resource();
+}
+
+std::uint32_t hash3(const std::uint8_t* p, std::uint32_t shift) {
+  const std::uint32_t v = static_cast<std::uint32_t>(p[0]) |
+                          (static_cast<std::uint32_t>(p[1]) << 8) |
+                          (static_cast<std::uint32_t>(p[2]) << 16);
+  return (v * 2654435761u) >> shift;
+}
+
+} // namespace
+
+// -------------------- Hash chain --------------------
+
+HashChainMatchFinder::HashChainMatchFinder(std::size_t windowSize,
+                                           std::size_t chainDepth,
+                                           std::pmr::memory_resource* memory)
+  : m_windowSize(windowSize)
+  , m_chainDepth(chainDepth == 0 ? 1 : chainDepth)
+  , m_head(orHeap(memory))
+  , m_prev(orHeap(memory))
+{
+  // prev[] is a ring indexed by position; it must cover the whole window.
+  const std::size_t prevSize = ringSize(windowSize);
+  m_prevMask = static_cast<std::uint32_t>(prevSize - 1);
+
+  const std::uint32_t hashBits = hashBitsFor(prevSize);
+  m_hashShift = 32u - hashBits;
+
+  m_head.assign(static_cast<std::size_t>(1) << hashBits, kNil);
+  m_prev.assign(prevSize, kNil);
+}
+
+std::size_t HashChainMatchFinder::ringSize(std::size_t windowSize) {
+  return roundUpPow2(windowSize == 0 ? 1 : windowSize);
+}
+
+std::size_t HashChainMatchFinder::memoryBytes(std::size_t windowSize) {
+  const std::size_t ring = ringSize(windowSize);
+  return sizeof(std::uint32_t) *
+         ((static_cast<std::size_t>(1) << hashBitsFor(ring)) + ring);
+}
+
+void HashChainMatchFinder::slide(std::uint32_t delta) {
+  rebase(m_head, delta);
+  rebase(m_prev, delta);
+}
+
+std::uint32_t HashChainMatchFinder::hash(const std::uint8_t* p) const {
+  return hash3(p, m_hashShift);
+}
+
+void HashChainMatchFinder::insert(const std::uint8_t* buf, std::uint32_t pos) {
+  const std::uint32_t h = hash(buf + pos);
+  m_prev[pos & m_prevMask] = m_head[h];
+  m_head[h] = pos;
+}
+
+LzMatch HashChainMatchFinder::find(const std::uint8_t* buf,
+                                   std::uint32_t pos,
+                                   std::uint32_t maxLen,
+                                   std::uint32_t minMatch) const {
+  LzMatch best;
+  if (maxLen < kHashBytes || maxLen < minMatch) {
+    return best;
+  }
+
+  const std::uint8_t* cur = buf + pos;
+  std::uint32_t cand = m_head[hash(cur)];
+  std::size_t depth = m_chainDepth;
+
+  while (cand != kNil && depth-- > 0) {
+    const std::uint32_t dist = pos - cand;
+    if (dist == 0 || dist > m_windowSize) {
+      break; // chain has run out of the window
+    }
+
+    const std::uint8_t* ref = buf + cand;
+    // Cheap reject: a longer match must agree at the current best length
+    if (ref[best.length] == cur[best.length]) {
+      const std::uint32_t k = matchLength(ref, cur, maxLen);
+      if (k > best.length) {
+        best.length = k;
+        best.offset = dist;
+        if (k == maxLen) {
+          break; // can't do better than maxLen
+        }
+      }
+    }
+
+    cand = m_prev[cand & m_prevMask];
+  }
+
+  // Enforce minimum match length: otherwise treat as no match
+  if (best.length < minMatch) {
+    best.length = 0;
+    best.offset = 0;
+  }
+  return best;
+}
+
+// -------------------- Binary tree --------------------
+
+BinaryTreeMatchFinder::BinaryTreeMatchFinder(std::size_t windowSize,
+                                             std::size_t depth,
+                                             std::pmr::memory_resource* memory)
+  : m_windowSize(windowSize)
+  , m_depth(depth == 0 ? 1 : depth)
+  , m_head(orHeap(memory))
+  , m_son(orHeap(memory))
+{
+  // One node per position; a node must survive for a full window after
+  // it is inserted, hence windowSize + 1 slots.
+  const std::size_t cyclicSize = ringSize(windowSize);
+  m_cyclicMask = static_cast<std::uint32_t>(cyclicSize - 1);
+
+  const std::uint32_t hashBits = hashBitsFor(cyclicSize);
+  m_hashShift = 32u - hashBits;
+
+  m_head.assign(static_cast<std::size_t>(1) << hashBits, kNil);
+  m_son.assign(cyclicSize * 2, kNil);
+}
+
+std::size_t BinaryTreeMatchFinder::ringSize(std::size_t windowSize) {
+  return roundUpPow2(windowSize + 1);
+}
+
+std::size_t BinaryTreeMatchFinder::memoryBytes(std::size_t windowSize) {
+  const std::size_t ring = ringSize(windowSize);
+  return sizeof(std::uint32_t) *
+         ((static_cast<std::size_t>(1) << hashBitsFor(ring)) + 2 * ring);
+}
+
+void BinaryTreeMatchFinder::slide(std::uint32_t delta) {
+  rebase(m_head, delta);
+  rebase(m_son, delta);
+}
+
+std::uint32_t BinaryTreeMatchFinder::hash(const std::uint8_t* p) const {
+  return hash3(p, m_hashShift);
+}
+
+std::size_t BinaryTreeMatchFinder::findAndInsert(const std::uint8_t* buf,
+                                                 std::uint32_t pos,
+                                                 std::uint32_t end,
+                                                 std::uint32_t maxLen,
+                                                 std::uint32_t minMatch,
+                                                 LzMatch* matches) {
+  if (pos + kHashBytes > end) {
+    return 0; // too close to the end to hash; nothing can match anyway
+  }
+  const std::uint32_t lenLimit = (end - pos < maxLen) ? (end - pos) : maxLen;
+
+  const std::uint8_t* cur = buf + pos;
+  const std::uint32_t h = hash(cur);
+  std::uint32_t cand = m_head[h];
+  m_head[h] = pos;
+
+  // ptrSmaller collects the subtree of strings < cur, ptrLarger those > cur
+  std::uint32_t* ptrLarger  = &m_son[2u * (pos & m_cyclicMask) + 1u];
+  std::uint32_t* ptrSmaller = &m_son[2u * (pos & m_cyclicMask)];
+  std::uint32_t lenLarger  = 0;
+  std::uint32_t lenSmaller = 0;
+  std::uint32_t bestLen = (minMatch > 0) ? (minMatch - 1) : 0;
+  std::size_t count = 0;
+  std::size_t depth = m_depth;
+
+  for (;;) {
+    const std::uint32_t dist = pos - cand;
+    if (cand == kNil || dist > m_windowSize || depth-- == 0) {
+      *ptrLarger = kNil;
+      *ptrSmaller = kNil;
+      return count;
+    }
+
+    std::uint32_t* pair = &m_son[2u * (cand & m_cyclicMask)];
+    const std::uint8_t* ref = buf + cand;
+
+    // Both subtrees we came through share at least this much with cur
+    std::uint32_t len = (lenLarger < lenSmaller) ? lenLarger : lenSmaller;
+    len += matchLength(ref + len, cur + len, lenLimit - len);
+
+    if (len > bestLen) {
+      bestLen = len;
+      matches[count].length = len;
+      matches[count].offset = dist;
+      ++count;
+    }
+
+    if (len == lenLimit) {
+      // cur replaces cand in the tree and adopts both of its subtrees
+      *ptrSmaller = pair[0];
+      *ptrLarger = pair[1];
+      return count;
+    }
+
+    if (ref[len] < cur[len]) {
+      *ptrSmaller = cand;
+      ptrSmaller = &pair[1];
+      cand = *ptrSmaller;
+      lenSmaller = len;
+    } else {
+      *ptrLarger = cand;
+      ptrLarger = &pair[0];
+      cand = *ptrLarger;
+      lenLarger = len;
+    }
+  }
+}
+
+} // namespace CompressionLib
@@ -0,0 +1,123 @@
+#ifndef COMPRESSION_LIB_MATCH_FINDER_HPP
+#define COMPRESSION_LIB_MATCH_FINDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace CompressionLib {
+
+  struct LzMatch {
+    std::uint32_t offset = 0; // distance back from the current position
+    std::uint32_t length = 0; // 0 = no match
+  };
+
+  /**
+   * Hash-chain match finder for LZ-style encoders.
+   *
+   * Every position is hashed on its first 3 bytes. head[] holds the most
+   * recent position for each hash and prev[] links each position to the
+   * previous one with the same hash, so a search only visits candidates
+   * that share a 3-byte prefix instead of the whole window. chainDepth
+   * bounds how many candidates are examined per search.
+   *
+   * Positions are indices into the caller's buffer. The caller must call
+   * insert() for every position it steps over (in increasing order) so the
+   * chains stay complete, and must call find() before insert() for the same
+   * position.
+   *
+   * Tables come from 'memory' (nullptr = the heap) and are sized by the
+   * window: about 4 bytes per window position plus up to 4 MiB of heads.
+   */
+  class HashChainMatchFinder {
+  public:
+    static constexpr std::uint32_t kHashBytes = 3;
+
+    HashChainMatchFinder(std::size_t windowSize, std::size_t chainDepth,
+                         std::pmr::memory_resource* memory = nullptr);
+
+    // Link position 'pos' into its hash chain. Requires pos + 3 <= buffer end.
+    void insert(const std::uint8_t* buf, std::uint32_t pos);
+
+    // Longest match for 'pos' within the window, at most maxLen bytes.
+    // Returns length 0 if nothing of at least minMatch bytes is found.
+    LzMatch find(const std::uint8_t* buf,
+                 std::uint32_t pos,
+                 std::uint32_t maxLen,
+                 std::uint32_t minMatch) const;
+
+    // Size of the position ring for a window. A sliding caller must move
+    // its buffer by multiples of this so ring slots stay in place.
+    static std::size_t ringSize(std::size_t windowSize);
+
+    // Bytes of tables a finder for this window allocates
+    static std::size_t memoryBytes(std::size_t windowSize);
+
+    // The caller dropped the first 'delta' bytes of its buffer: rebase all
+    // stored positions. delta must be a multiple of ringSize().
+    void slide(std::uint32_t delta);
+
+  private:
+    std::uint32_t hash(const std::uint8_t* p) const;
+
+    std::size_t m_windowSize;
+    std::size_t m_chainDepth;
+    std::uint32_t m_hashShift;
+    std::uint32_t m_prevMask;
+    std::pmr::vector<std::uint32_t> m_head;
+    std::pmr::vector<std::uint32_t> m_prev;
+  };
+
+  /**
+   * Binary-tree match finder (LZMA "bt3" style) for optimal parsing.
+   *
+   * Each hash bucket roots a binary search tree of earlier positions
+   * ordered by the strings that start there. Inserting a position walks
+   * that tree once and reports every match that is longer than the one
+   * before it, so a parser sees all useful (length, offset) candidates,
+   * each with the smallest offset found for that length.
+   *
+   * Every position must go through findAndInsert() in increasing order;
+   * the tree is rebuilt around the new node as it is searched. Tables
+   * come from 'memory' (nullptr = the heap): about 8 bytes per window
+   * position plus up to 4 MiB of heads.
+   */
+  class BinaryTreeMatchFinder {
+  public:
+    static constexpr std::uint32_t kHashBytes = 3;
+
+    BinaryTreeMatchFinder(std::size_t windowSize, std::size_t depth,
+                          std::pmr::memory_resource* memory = nullptr);
+
+    // Insert 'pos' and write its candidates to 'matches' in strictly
+    // increasing length order. 'end' is the end of valid data in buf and
+    // maxLen the longest match worth reporting. Returns the count written;
+    // 'matches' must have room for maxLen entries.
+    std::size_t findAndInsert(const std::uint8_t* buf,
+                              std::uint32_t pos,
+                              std::uint32_t end,
+                              std::uint32_t maxLen,
+                              std::uint32_t minMatch,
+                              LzMatch* matches);
+
+    // Same contract as HashChainMatchFinder::ringSize() / slide() /
+    // memoryBytes()
+    static std::size_t ringSize(std::size_t windowSize);
+    void slide(std::uint32_t delta);
+    static std::size_t memoryBytes(std::size_t windowSize);
+
+  private:
+    std::uint32_t hash(const std::uint8_t* p) const;
+
+    std::size_t m_windowSize;
+    std::size_t m_depth;
+    std::uint32_t m_hashShift;
+    std::uint32_t m_cyclicMask;
+    std::pmr::vector<std::uint32_t> m_head;
+    std::pmr::vector<std::uint32_t> m_son; // [2*node] = smaller, [2*node+1] = larger
+  };
+
+} // namespace CompressionLib
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef COMPRESSION_LIB_MATCH_LENGTH_HPP
+#define COMPRESSION_LIB_MATCH_LENGTH_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// Vector width is picked at build time from the target's predefined
+// macros. Define COMPRESSION_LIB_NO_SIMD to force the portable word loop.
+#if !defined(COMPRESSION_LIB_NO_SIMD) && defined(__SSE2__)
+  #include <emmintrin.h>
+  #define COMPRESSION_LIB_MATCH_SSE2 1
+#elif !defined(COMPRESSION_LIB_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+  #include <arm_neon.h>
+  #define COMPRESSION_LIB_MATCH_NEON 1
+#endif
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__)
+  #define COMPRESSION_LIB_MATCH_WORDS 1
+#endif
+
+namespace CompressionLib {
+
+  /**
+   * Number of leading bytes that are equal in a and b, at most 'limit'.
+   * Both pointers must have 'limit' readable bytes; nothing past that is
+   * touched. The ranges may overlap (a == b + offset for an LZ match).
+   *
+   * Compares 16 bytes per step with SSE2 / NEON where available, then
+   * 8 bytes per step via XOR + count-trailing-zeros, then single bytes.
+   */
+  inline std::uint32_t matchLength(const std::uint8_t* a,
+                                   const std::uint8_t* b,
+                                   std::uint32_t limit) {
+    std::uint32_t len = 0;
+
+#if defined(COMPRESSION_LIB_MATCH_SSE2)
+    while (len + 16 <= limit) {
+      const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + len));
+      const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + len));
+      const unsigned eq = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)));
+      if (eq != 0xFFFFu) {
+        return len + static_cast<std::uint32_t>(__builtin_ctz(~eq));
+      }
+      len += 16;
+    }
+#elif defined(COMPRESSION_LIB_MATCH_NEON)
+    while (len + 16 <= limit) {
+      const uint8x16_t eq = vceqq_u8(vld1q_u8(a + len), vld1q_u8(b + len));
+      // Narrow to 4 bits per byte so the mask fits in one 64-bit lane
+      const uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+      const std::uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(nib), 0);
+      if (mask != ~static_cast<std::uint64_t>(0)) {
+        return len + static_cast<std::uint32_t>(__builtin_ctzll(~mask) >> 2);
+      }
+      len += 16;
+    }
+#endif
+
+#if defined(COMPRESSION_LIB_MATCH_WORDS)
+    while (len + 8 <= limit) {
+      std::uint64_t wa;
+      std::uint64_t wb;
+      std::memcpy(&wa, a + len, 8);
+      std::memcpy(&wb, b + len, 8);
+      const std::uint64_t diff = wa ^ wb;
+      if (diff != 0) {
+  #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return len + static_cast<std::uint32_t>(__builtin_ctzll(diff) >> 3);
+  #else
+        return len + static_cast<std::uint32_t>(__builtin_clzll(diff) >> 3);
+  #endif
+      }
+      len += 8;
+    }
+#endif
+
+    while (len < limit && a[len] == b[len]) {
+      ++len;
+    }
+    return len;
+  }
+
+} // namespace CompressionLib
+
+#endif
@@ -0,0 +1,92 @@
+#include "compress/Lib/CompressionLib/Parallel.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+namespace CompressionLib {
+
+WorkerPool::WorkerPool(unsigned workers)
+  : m_workers(std::max(workers, 1u))
+  , m_threads(new std::thread[m_workers - 1])
+{
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (unsigned t = 0; t < m_started; ++t) {
+    m_threads[t].join();
+  }
+}
+
+unsigned WorkerPool::start(unsigned helpers) {
+  while (m_started < helpers) {
+    try {
+      m_threads[m_started] = std::thread(&WorkerPool::helperLoop, this, m_started + 1);
+    } catch (const std::system_error&) {
+      break; // out of threads: run with what we have
+    }
+    ++m_started;
+  }
+  return std::min(helpers, m_started);
+}
+
+void WorkerPool::runJob(std::size_t count, unsigned threads, Call call, void* fn) {
+  threads = std::min(threads, m_workers);
+  const unsigned wanted =
+      (threads > 1 && count > 1)
+          ? static_cast<unsigned>(std::min<std::size_t>(count, threads)) - 1
+          : 0;
+  // Threads start outside the lock; none of them is in a batch yet
+  const unsigned helpers = start(wanted);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_call = call;
+    m_fn = fn;
+    m_count = count;
+    m_next.store(0, std::memory_order_relaxed);
+    m_helpers = helpers;
+    m_busy = helpers;
+    ++m_generation;
+  }
+  if (helpers > 0) {
+    m_wake.notify_all();
+  }
+  work(0);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_busy == 0; });
+}
+
+void WorkerPool::helperLoop(unsigned worker) {
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+    if (m_stop) {
+      return;
+    }
+    seen = m_generation;
+    // Workers past this batch's count sit it out
+    if (worker > m_helpers) {
+      continue;
+    }
+    lock.unlock();
+    work(worker);
+    lock.lock();
+    if (--m_busy == 0) {
+      m_done.notify_one();
+    }
+  }
+}
+
+void WorkerPool::work(unsigned worker) {
+  for (std::size_t i = m_next++; i < m_count; i = m_next++) {
+    m_call(m_fn, i, worker);
+  }
+}
+
+} // namespace CompressionLib
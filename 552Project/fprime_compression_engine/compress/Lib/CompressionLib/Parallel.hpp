@@ -0,0 +1,102 @@
+#ifndef COMPRESSION_LIB_PARALLEL_HPP
+#define COMPRESSION_LIB_PARALLEL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace CompressionLib {
+
+  // Threads to use for a job: 'requested', or one per hardware thread
+  // when it is 0 (falling back to 1 if the count is unknown).
+  inline unsigned workerCount(std::uint32_t requested) {
+    if (requested != 0) {
+      return requested;
+    }
+    const unsigned hw = std::thread::hardware_concurrency();
+    return (hw == 0) ? 1u : hw;
+  }
+
+  /**
+   * Worker threads kept from one batch to the next, so running a batch
+   * starts no threads and allocates nothing.
+   *
+   * A pool of n workers has n - 1 threads of its own; the thread calling
+   * run() is worker 0. Threads start the first time a batch needs them and
+   * stay until the pool is destroyed. A pool runs one batch at a time.
+   */
+  class WorkerPool {
+  public:
+    explicit WorkerPool(unsigned workers);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned workers() const { return m_workers; }
+
+    // Run fn(i, worker) for every i in [0, count) on up to 'threads'
+    // workers (capped at workers()); see parallelForWorkers
+    template <typename Fn>
+    void run(std::size_t count, unsigned threads, Fn& fn) {
+      auto call = [](void* f, std::size_t i, unsigned worker) {
+        (*static_cast<Fn*>(f))(i, worker);
+      };
+      runJob(count, threads, call, &fn);
+    }
+
+  private:
+    using Call = void (*)(void*, std::size_t, unsigned);
+
+    void runJob(std::size_t count, unsigned threads, Call call, void* fn);
+
+    // Start threads up to 'helpers'; the number running
+    unsigned start(unsigned helpers);
+
+    void helperLoop(unsigned worker);
+
+    // Take items of the current batch until none are left
+    void work(unsigned worker);
+
+    const unsigned m_workers;
+    std::unique_ptr<std::thread[]> m_threads;
+    unsigned m_started = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::uint64_t m_generation = 0; // bumped for each batch
+    unsigned m_helpers = 0;         // threads taking part in the batch
+    unsigned m_busy = 0;            // of which still working
+    bool m_stop = false;
+
+    Call m_call = nullptr;
+    void* m_fn = nullptr;
+    std::size_t m_count = 0;
+    std::atomic<std::size_t> m_next{0};
+  };
+
+  /**
+   * Run fn(i, worker) for every i in [0, count) on up to 'threads'
+   * workers of 'pool', where worker in [0, threads) names the thread
+   * running the item; no two items run on the same worker at once, so fn
+   * can keep per-worker scratch.
+   *
+   * Items are handed out one at a time from a shared counter, so uneven
+   * items still balance. The calling thread works too; if a worker thread
+   * cannot be started the remaining threads simply take more items.
+   * fn must not throw.
+   */
+  template <typename Fn>
+  void parallelForWorkers(WorkerPool& pool, std::size_t count, unsigned threads,
+                          Fn fn) {
+    pool.run(count, threads, fn);
+  }
+
+} // namespace CompressionLib
+
+#endif
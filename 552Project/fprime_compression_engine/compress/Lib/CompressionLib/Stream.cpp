@@ -0,0 +1,453 @@
+#include "compress/Lib/CompressionLib/Stream.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory_resource>
+#include <vector>
+
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Crc32c.hpp"
+
+namespace CompressionLib {
+
+namespace {
+
+constexpr std::uint8_t kStreamFlags = kContainerChecksums | kContainerStreamed;
+constexpr std::size_t kEntrySize = containerEntrySize(kStreamFlags);
+
+// Arenas reserve whole 64-byte lines
+std::size_t lines(std::size_t bytes) {
+  return (bytes + 63) & ~std::size_t{63};
+}
+
+// Block codec for 'params' built in 'instance'; null if the codec is not
+// registered or has no stream form
+BlockCodec* streamCodec(const StreamParams& params, BlockCodecInstance& instance) {
+  const Codec* codec = findCodec(params.algo);
+  if (codec == nullptr || !codec->capabilities().streaming) {
+    return nullptr;
+  }
+  return instance.emplace(params.algo, params.level);
+}
+
+// Block size for 'params' with 'codec'
+std::uint32_t streamBlockSize(const StreamParams& params, const BlockCodec& codec) {
+  const std::uint32_t limit = std::max<std::uint32_t>(codec.blockSize(), 1);
+  return (params.blockSize == 0) ? limit : std::min(params.blockSize, limit);
+}
+
+// Parameter bytes 'codec' writes into a header
+std::size_t paramsSize(const BlockCodec& codec) {
+  std::array<std::uint8_t, 256> buffer;
+  std::pmr::monotonic_buffer_resource memory(buffer.data(), buffer.size());
+  std::pmr::vector<std::uint8_t> params(&memory);
+  codec.writeParams(params);
+  return params.size();
+}
+
+// Arena sizes of a stream: buffers, then scratch
+struct StreamMemory {
+  std::size_t buffers = 0;
+  std::size_t scratch = 0;
+};
+
+StreamMemory compressMemory(const BlockCodec& codec, std::uint32_t blockSize) {
+  StreamMemory m;
+  m.buffers = lines(blockSize) + lines(kContainerMaxHeaderSize + paramsSize(codec));
+  m.scratch = lines(codec.scratchBytes(blockSize));
+  return m;
+}
+
+// The header is gathered in the stream object and the parameters before
+// these are taken, so a part is an entry or a payload
+StreamMemory decompressMemory(const BlockCodec& codec, std::uint32_t blockSize) {
+  StreamMemory m;
+  m.buffers = lines(std::max<std::size_t>(blockSize, kEntrySize)) +
+              lines(blockSize + kBlockSlack);
+  m.scratch = lines(codec.scratchBytes(blockSize));
+  return m;
+}
+
+} // namespace
+
+// -------------------- Public API: CompressStream --------------------
+
+CompressStream::CompressStream() = default;
+CompressStream::~CompressStream() = default;
+
+std::size_t CompressStream::memoryBytes(const StreamParams& params) {
+  BlockCodecInstance codecs;
+  const BlockCodec* codec = streamCodec(params, codecs);
+  if (codec == nullptr) {
+    return 0;
+  }
+  const StreamMemory m = compressMemory(*codec, streamBlockSize(params, *codec));
+  return m.buffers + m.scratch;
+}
+
+std::int32_t CompressStream::begin(const StreamParams& params) {
+  const int level = std::min(std::max(params.level, kMinLevel), kMaxLevel);
+  m_state = State::Idle;
+  m_codec = streamCodec(params, m_codecs);
+  if (m_codec == nullptr) {
+    return -99;
+  }
+  m_blockSize = streamBlockSize(params, *m_codec);
+  const StreamMemory m = compressMemory(*m_codec, m_blockSize);
+  m_buffers.reserve(m.buffers);
+  m_scratch.reserve(m.scratch);
+  m_block = m_buffers.alloc<std::uint8_t>(m_blockSize);
+  m_fill = 0;
+  m_crc = 0;
+
+  // Length and block count stay 0: they are only known at the end
+  std::pmr::vector<std::uint8_t> codecParams(&m_scratch);
+  m_codec->writeParams(codecParams);
+  ContainerInfo info;
+  info.codec      = params.algo;
+  info.level      = static_cast<std::uint8_t>(level);
+  info.flags      = kStreamFlags;
+  info.blockSize  = m_blockSize;
+  info.paramsSize = static_cast<std::uint32_t>(codecParams.size());
+  const std::size_t headerSize = containerHeaderSize(info) + info.paramsSize;
+  std::uint8_t* header = m_buffers.alloc<std::uint8_t>(headerSize);
+  writeContainerHeader(header, info, codecParams.data());
+  m_scratch.reset();
+
+  m_queue[0] = header;
+  m_queueSize[0] = headerSize;
+  m_queueSize[1] = 0;
+  m_state = State::Open;
+  return 0;
+}
+
+StreamResult CompressStream::update(const std::uint8_t* in, std::size_t inLen,
+                                    std::uint8_t* out, std::size_t outCap) {
+  StreamResult r;
+  if (m_state != State::Open) {
+    r.error = -1;
+    return r;
+  }
+  // Input is only taken once earlier output is gone, so a queued
+  // payload can point into the block buffer
+  while (drain(out, outCap, r) && r.consumed < inLen) {
+    const std::size_t left = inLen - r.consumed;
+    if (m_fill == 0 && left >= m_blockSize) {
+      codeBlock(in + r.consumed, m_blockSize);
+      r.consumed += m_blockSize;
+      continue;
+    }
+    const std::size_t take = std::min<std::size_t>(left, m_blockSize - m_fill);
+    std::memcpy(m_block + m_fill, in + r.consumed, take);
+    m_fill += take;
+    r.consumed += take;
+    if (m_fill == m_blockSize) {
+      codeBlock(m_block, m_fill);
+    }
+  }
+  return pending(r);
+}
+
+StreamResult CompressStream::flush(std::uint8_t* out, std::size_t outCap) {
+  StreamResult r;
+  if (m_state != State::Open) {
+    r.error = -1;
+    return r;
+  }
+  if (drain(out, outCap, r) && m_fill > 0) {
+    codeBlock(m_block, m_fill);
+    drain(out, outCap, r);
+  }
+  return pending(r);
+}
+
+StreamResult CompressStream::finish(std::uint8_t* out, std::size_t outCap) {
+  StreamResult r;
+  if (m_state == State::Open) {
+    r = flush(out, outCap);
+    if (r.pending != 0) {
+      return r;
+    }
+    writeContainerEntry(m_entry, kStreamFlags, 0, 0, m_crc);
+    m_queue[0] = m_entry;
+    m_queueSize[0] = kEntrySize;
+    m_state = State::Closed;
+  } else if (m_state != State::Closed) {
+    r.error = -1;
+    return r;
+  }
+  drain(out, outCap, r);
+  return pending(r);
+}
+
+void CompressStream::codeBlock(const std::uint8_t* data, std::size_t n) {
+  // The last payload has been output, so scratch starts over
+  m_scratch.reset();
+  const std::uint32_t crc = crc32c(0, data, n);
+  const std::uint8_t* payload = data;
+  std::size_t size = n;
+  std::pmr::vector<std::uint8_t> coded(&m_scratch);
+  if (m_codec->encodeBlock(data, n, m_scratch, coded) && coded.size() < n) {
+    // Arenas ignore deallocation, so the payload outlives 'coded'
+    payload = coded.data();
+    size = coded.size();
+  } else if (data != m_block) {
+    // A block stored from the caller's input must outlive the call
+    std::memcpy(m_block, data, n);
+    payload = m_block;
+  }
+
+  writeContainerEntry(m_entry, kStreamFlags, static_cast<std::uint32_t>(size),
+                      static_cast<std::uint32_t>(n), crc);
+  m_queue[0] = m_entry;
+  m_queueSize[0] = kEntrySize;
+  m_queue[1] = payload;
+  m_queueSize[1] = size;
+  m_crc = crc32cCombine(m_crc, crc, n);
+  m_fill = 0;
+}
+
+bool CompressStream::drain(std::uint8_t* out, std::size_t outCap,
+                           StreamResult& r) {
+  for (int i = 0; i < 2; ++i) {
+    const std::size_t n = std::min(m_queueSize[i], outCap - r.produced);
+    if (n > 0) {
+      std::memcpy(out + r.produced, m_queue[i], n);
+      m_queue[i] += n;
+      m_queueSize[i] -= n;
+      r.produced += n;
+    }
+    if (m_queueSize[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+StreamResult CompressStream::pending(StreamResult r) const {
+  r.pending = m_queueSize[0] + m_queueSize[1];
+  return r;
+}
+
+// -------------------- Public API: DecompressStream --------------------
+
+DecompressStream::DecompressStream() = default;
+DecompressStream::~DecompressStream() = default;
+
+std::size_t DecompressStream::memoryBytes(const StreamParams& params) {
+  BlockCodecInstance codecs;
+  const BlockCodec* codec = streamCodec(params, codecs);
+  if (codec == nullptr) {
+    return 0;
+  }
+  const StreamMemory m = decompressMemory(*codec, streamBlockSize(params, *codec));
+  return m.buffers + m.scratch;
+}
+
+std::int32_t DecompressStream::begin(std::size_t maxMemory) {
+  m_codec = nullptr;
+  m_maxMemory = maxMemory;
+  m_memory.reserve(maxMemory);
+  m_part = nullptr;
+  m_raw = nullptr;
+  m_need = 0;
+  m_have = 0;
+  m_crc = 0;
+  m_error = 0;
+  m_outSize = 0;
+  m_state = State::Header;
+  return 0;
+}
+
+StreamResult DecompressStream::update(const std::uint8_t* in, std::size_t inLen,
+                                      std::uint8_t* out, std::size_t outCap) {
+  StreamResult r;
+  if (m_state == State::Idle || m_state == State::Failed) {
+    r.error = (m_state == State::Idle) ? -1 : m_error;
+    return r;
+  }
+  // Input is only taken once the last block is out, so the block can
+  // stay where it was decoded
+  const std::uint8_t* data = nullptr;
+  while (drain(out, outCap, r) && m_state != State::Done) {
+    if (m_state == State::Header) {
+      // The header's length is only known once all of it is in, so it
+      // is taken a byte at a time
+      if (r.consumed == inLen) {
+        break;
+      }
+      m_header[m_have++] = in[r.consumed++];
+      m_error = parseHeader();
+    } else if (gather(in, inLen, r, data)) {
+      m_error = parse(data, data != m_part);
+    } else {
+      break;
+    }
+    if (m_error != 0) {
+      m_state = State::Failed;
+      r.error = m_error;
+      break;
+    }
+  }
+  r.pending = m_outSize;
+  return r;
+}
+
+StreamResult DecompressStream::finish(std::uint8_t* out, std::size_t outCap) {
+  StreamResult r;
+  if (m_state == State::Idle || m_state == State::Failed) {
+    r.error = (m_state == State::Idle) ? -1 : m_error;
+    return r;
+  }
+  drain(out, outCap, r);
+  r.pending = m_outSize;
+  if (r.pending == 0 && m_state != State::Done) {
+    r.error = -3; // cut short
+  }
+  return r;
+}
+
+bool DecompressStream::gather(const std::uint8_t* in, std::size_t inLen,
+                              StreamResult& r, const std::uint8_t*& data) {
+  const std::size_t left = inLen - r.consumed;
+  if (m_have == 0 && left >= m_need) {
+    data = in + r.consumed;
+    r.consumed += m_need;
+    return true;
+  }
+  const std::size_t take = std::min(left, m_need - m_have);
+  if (take > 0) {
+    std::memcpy(m_part + m_have, in + r.consumed, take);
+  }
+  m_have += take;
+  r.consumed += take;
+  if (m_have < m_need) {
+    return false;
+  }
+  data = m_part;
+  m_have = 0;
+  return true;
+}
+
+std::int32_t DecompressStream::parseHeader() {
+  // Anything else fails at its first byte that differs from the magic
+  const std::size_t last = m_have - 1;
+  if (last < sizeof(kContainerMagic) &&
+      m_header[last] != static_cast<std::uint8_t>(kContainerMagic[last])) {
+    return -3;
+  }
+  ContainerInfo info;
+  if (!readContainerHeader(m_header, m_have, info)) {
+    return (m_have < kContainerMaxHeaderSize) ? 0 : -3;
+  }
+  if ((info.flags & kContainerStreamed) == 0 || info.blockSize == 0) {
+    return -3;
+  }
+  StreamParams params;
+  params.algo = info.codec;
+  params.level = std::max<int>(info.level, kMinLevel);
+  m_codec = streamCodec(params, m_codecs);
+  if (m_codec == nullptr) {
+    return (findCodec(info.codec) == nullptr) ? -99 : -3;
+  }
+  m_flags = info.flags;
+  m_blockSize = info.blockSize;
+  m_need = info.paramsSize;
+  m_have = 0;
+  // Parameters that arrive in pieces are gathered ahead of the blocks,
+  // which only take their memory once the parameters are read
+  if (m_maxMemory != 0 && m_need > m_maxMemory) {
+    return -2;
+  }
+  m_part = m_memory.alloc<std::uint8_t>(m_need);
+  m_state = State::Params;
+  return 0;
+}
+
+std::int32_t DecompressStream::reserveBlocks() {
+  const StreamMemory m = decompressMemory(*m_codec, m_blockSize);
+  if (m_maxMemory != 0 && m.buffers + m.scratch > m_maxMemory) {
+    return -2;
+  }
+  // Drops the parameters, which are read by now
+  m_memory.reserve(m.buffers + m.scratch);
+  m_part = m_memory.alloc<std::uint8_t>(std::max<std::size_t>(m_blockSize, kEntrySize));
+  m_raw = m_memory.alloc<std::uint8_t>(m_blockSize + kBlockSlack);
+  m_scratchMark = m_memory.mark();
+  return 0;
+}
+
+std::int32_t DecompressStream::parse(const std::uint8_t* data, bool inCaller) {
+  const bool checksums = (m_flags & kContainerChecksums) != 0;
+  switch (m_state) {
+    case State::Params: {
+      if (!m_codec->readParams(data, m_need)) {
+        return -3;
+      }
+      const std::int32_t error = reserveBlocks();
+      if (error != 0) {
+        return error;
+      }
+      m_need = containerEntrySize(m_flags);
+      m_state = State::Entry;
+      return 0;
+    }
+    case State::Entry: {
+      ContainerBlock b;
+      readContainerEntry(data, m_flags, b);
+      if (b.size == 0 && b.rawSize == 0) {
+        m_state = State::Done;
+        return (checksums && b.crc != m_crc) ? -4 : 0;
+      }
+      if (b.rawSize == 0 || b.rawSize > m_blockSize || b.size > b.rawSize) {
+        return -3;
+      }
+      m_size = b.size;
+      m_rawSize = b.rawSize;
+      m_blockCrc = b.crc;
+      m_need = m_size;
+      m_state = State::Payload;
+      return 0;
+    }
+    case State::Payload: {
+      m_out = data;
+      if (m_size != m_rawSize) {
+        m_memory.release(m_scratchMark);
+        if (!m_codec->decodeBlock(data, m_size, m_raw, m_rawSize, m_memory)) {
+          return -3;
+        }
+        m_out = m_raw;
+      } else if (inCaller) {
+        // A stored block in the caller's input must outlive the call
+        std::memcpy(m_raw, data, m_rawSize);
+        m_out = m_raw;
+      }
+      if (checksums && crc32c(0, m_out, m_rawSize) != m_blockCrc) {
+        return -4;
+      }
+      m_crc = crc32cCombine(m_crc, m_blockCrc, m_rawSize);
+      m_outSize = m_rawSize;
+      m_need = containerEntrySize(m_flags);
+      m_state = State::Entry;
+      return 0;
+    }
+    default:
+      return -3;
+  }
+}
+
+bool DecompressStream::drain(std::uint8_t* out, std::size_t outCap,
+                             StreamResult& r) {
+  const std::size_t n = std::min(m_outSize, outCap - r.produced);
+  if (n > 0) {
+    std::memcpy(out + r.produced, m_out, n);
+    m_out += n;
+    m_outSize -= n;
+    r.produced += n;
+  }
+  return m_outSize == 0;
+}
+
+} // namespace CompressionLib
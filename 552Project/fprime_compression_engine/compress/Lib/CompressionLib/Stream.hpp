@@ -0,0 +1,194 @@
+#ifndef COMPRESSION_LIB_STREAM_HPP
+#define COMPRESSION_LIB_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "compress/Lib/CompressionLib/Arena.hpp"
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+
+namespace CompressionLib {
+
+  struct StreamParams {
+    Algorithm     algo      = Algorithm::LZH;
+    int           level     = kDefaultLevel;
+    // Most raw bytes per block: 0 for the codec's own block size at
+    // 'level', which is also the largest allowed. Smaller blocks need
+    // less memory and hold back less data between flushes, and compress
+    // a little worse.
+    std::uint32_t blockSize = 0;
+  };
+
+  struct StreamResult {
+    std::size_t  consumed = 0; // input bytes taken
+    std::size_t  produced = 0; // output bytes written
+    std::size_t  pending  = 0; // output bytes still waiting for room
+    std::int32_t error    = 0; // as Result::error
+  };
+
+  /**
+   * Incremental compression of data that arrives a piece at a time, such
+   * as a log or a sensor feed. Writes a streamed container (see
+   * Container.hpp) that decompressFile, decompressBuffer and
+   * DecompressStream all read.
+   *
+   * Input is gathered into blocks, each coded on the calling thread as
+   * soon as it fills; whole blocks passed to one update() are coded
+   * where they are, without a copy. flush() codes a partial block at
+   * once, so everything consumed so far decodes from the output so far.
+   * Output can be taken in pieces of any size: what does not fit waits
+   * for the next call.
+   *
+   * begin() reserves all the memory a stream uses, memoryBytes(params),
+   * and nothing is allocated after it.
+   */
+  class CompressStream {
+  public:
+    CompressStream();
+    ~CompressStream();
+    CompressStream(const CompressStream&) = delete;
+    CompressStream& operator=(const CompressStream&) = delete;
+
+    // Memory begin(params) reserves: a block of input, the header and
+    // the codec's working memory; 0 for DCT
+    static std::size_t memoryBytes(const StreamParams& params);
+
+    // Start a new stream, dropping any unfinished one. 0, or -99 for a
+    // codec with no stream form (DCT) or not built into the library.
+    std::int32_t begin(const StreamParams& params);
+
+    // Take input and write output until 'in' is used up or 'out' is
+    // full; call again with the rest of 'in' if consumed < inLen. error
+    // is -1 if no stream is open.
+    StreamResult update(const std::uint8_t* in, std::size_t inLen,
+                        std::uint8_t* out, std::size_t outCap);
+
+    // Code the input held back so far as a block of its own; call again
+    // while pending != 0
+    StreamResult flush(std::uint8_t* out, std::size_t outCap);
+
+    // Flush and close the stream; call again while pending != 0. The
+    // next stream starts with begin().
+    StreamResult finish(std::uint8_t* out, std::size_t outCap);
+
+  private:
+    enum class State { Idle, Open, Closed };
+
+    // Code n bytes as the next block and queue its entry and payload
+    void codeBlock(const std::uint8_t* data, std::size_t n);
+
+    // Copy queued output to 'out'; true once the queue is empty
+    bool drain(std::uint8_t* out, std::size_t outCap, StreamResult& r);
+
+    StreamResult pending(StreamResult r) const;
+
+    State m_state = State::Idle;
+    BlockCodecInstance m_codecs;
+    const BlockCodec* m_codec = nullptr;
+    Arena m_buffers; // block being gathered, header
+    Arena m_scratch; // codec working memory and the coded block
+    std::uint8_t* m_block = nullptr;
+    std::uint32_t m_blockSize = 0;
+    std::size_t m_fill = 0;
+    std::uint32_t m_crc = 0;
+
+    // Output waiting for room: an entry (or the header), then a payload
+    const std::uint8_t* m_queue[2] = {};
+    std::size_t m_queueSize[2] = {};
+    std::uint8_t m_entry[12] = {};
+  };
+
+  /**
+   * Incremental decompression of a streamed container, a piece at a
+   * time. The codec, its parameters and the block size all come from the
+   * stream's header. Each block is output as soon as all of it has
+   * arrived, so the data up to the writer's last flush decodes even from
+   * a stream cut short. Blocks are checked against their checksums as
+   * they decode and the whole against the end entry; anything after the
+   * end entry is left unconsumed.
+   *
+   * Memory for the blocks is taken once the header is in, and nothing is
+   * allocated after that. A caller that must bound it passes a cap to
+   * begin(), which reserves the cap there instead; a stream that needs
+   * more then fails with -2.
+   */
+  class DecompressStream {
+  public:
+    DecompressStream();
+    ~DecompressStream();
+    DecompressStream(const DecompressStream&) = delete;
+    DecompressStream& operator=(const DecompressStream&) = delete;
+
+    // Memory a stream written by CompressStream with 'params' needs: a
+    // block in each form and the codec's working memory; 0 for DCT. A
+    // cap of this much decodes it.
+    static std::size_t memoryBytes(const StreamParams& params);
+
+    // Start on a new stream. maxMemory 0 sizes memory from the header;
+    // otherwise maxMemory bytes are reserved now and are all the stream
+    // may use.
+    std::int32_t begin(std::size_t maxMemory = 0);
+
+    // Take input and write output until 'in' is used up or 'out' is
+    // full. error is -3 for data that is not a stream this decodes, -4 on
+    // a checksum mismatch, -2 if the stream needs more than the cap given
+    // to begin() and -99 if it names a codec not built into the library;
+    // the stream stays failed until begin().
+    StreamResult update(const std::uint8_t* in, std::size_t inLen,
+                        std::uint8_t* out, std::size_t outCap);
+
+    // Write what is left; call again while pending != 0. error is -3 if
+    // the input ended before the end entry.
+    StreamResult finish(std::uint8_t* out, std::size_t outCap);
+
+  private:
+    enum class State { Idle, Header, Params, Entry, Payload, Done, Failed };
+
+    // Take the next m_need bytes of the current part, straight from 'in'
+    // if none are buffered yet; true with 'data' set once all are in
+    bool gather(const std::uint8_t* in, std::size_t inLen, StreamResult& r,
+                const std::uint8_t*& data);
+
+    // Try the header bytes gathered so far; 0 if they are the header or
+    // may yet be, else the error that fails the stream
+    std::int32_t parseHeader();
+
+    // Take the memory for blocks once the codec has its parameters; 0,
+    // or -2 if it is more than the cap
+    std::int32_t reserveBlocks();
+
+    // Handle one complete part, 'inCaller' if it lies in the caller's
+    // input; 0 or the error that fails the stream
+    std::int32_t parse(const std::uint8_t* data, bool inCaller);
+
+    bool drain(std::uint8_t* out, std::size_t outCap, StreamResult& r);
+
+    State m_state = State::Idle;
+    BlockCodecInstance m_codecs;
+    BlockCodec* m_codec = nullptr;
+    // A part being gathered and the decoded block, then codec working
+    // memory from m_scratchMark on
+    Arena m_memory;
+    Arena::Mark m_scratchMark;
+    std::size_t m_maxMemory = 0;
+    std::uint8_t m_header[kContainerMaxHeaderSize] = {};
+    std::uint8_t* m_part = nullptr;
+    std::uint8_t* m_raw = nullptr;
+    std::size_t m_need = 0;
+    std::size_t m_have = 0;
+    std::uint8_t m_flags = 0;
+    std::uint32_t m_blockSize = 0;
+    std::uint32_t m_size = 0;    // current block's coded bytes
+    std::uint32_t m_rawSize = 0; // and raw bytes
+    std::uint32_t m_blockCrc = 0;
+    std::uint32_t m_crc = 0;     // of everything decoded
+    std::int32_t m_error = 0;
+
+    const std::uint8_t* m_out = nullptr;
+    std::size_t m_outSize = 0;
+  };
+
+} // namespace CompressionLib
+
+#endif
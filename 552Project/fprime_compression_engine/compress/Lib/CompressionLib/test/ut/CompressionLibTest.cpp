@@ -0,0 +1,538 @@
+// Round trips through every lossless codec and level, files from the
+// releases before the container, and the checks that keep damaged input
+// from decoding as anything.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "compress/Lib/CompressionLib/Codecs.hpp"
+#include "compress/Lib/CompressionLib/CompressionLib.hpp"
+#include "compress/Lib/CompressionLib/Container.hpp"
+#include "compress/Lib/CompressionLib/Context.hpp"
+#include "compress/Lib/CompressionLib/Stream.hpp"
+#include "compress/Lib/CompressionLib/test/ut/LegacyFiles.hpp"
+#include "gtest/gtest.h"
+
+using namespace CompressionLib;
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+constexpr Algorithm kLossless[] = {Algorithm::HUFFMAN, Algorithm::LZSS,
+                                   Algorithm::ANS, Algorithm::LZH};
+
+// Same bytes every run: xorshift
+class Random {
+public:
+  explicit Random(std::uint32_t seed) : m_state(seed) {}
+  std::uint32_t next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+
+private:
+  std::uint32_t m_state;
+};
+
+Bytes randomBytes(std::size_t n, std::uint32_t seed) {
+  Random r(seed);
+  Bytes b(n);
+  for (auto& v : b) {
+    v = static_cast<std::uint8_t>(r.next());
+  }
+  return b;
+}
+
+// Log-like text: a few fields repeating with small changes
+Bytes textBytes(std::size_t n, std::uint32_t seed) {
+  Random r(seed);
+  std::string s;
+  while (s.size() < n) {
+    s += "t=" + std::to_string(s.size() / 40) + " temp=" +
+         std::to_string(200 + r.next() % 20) + " mode=" +
+         ((r.next() % 8 == 0) ? "SAFE" : "NOMINAL") + "\n";
+  }
+  return Bytes(s.begin(), s.begin() + static_cast<std::ptrdiff_t>(n));
+}
+
+// Sensor samples: a slow wave plus noise, 16 bits each
+Bytes sensorBytes(std::size_t n, std::uint32_t seed) {
+  Random r(seed);
+  Bytes b(n);
+  for (std::size_t i = 0; i + 1 < n; i += 2) {
+    const auto v = static_cast<std::uint16_t>(
+        2048 + ((i / 64) % 256) + (r.next() % 16));
+    b[i] = static_cast<std::uint8_t>(v);
+    b[i + 1] = static_cast<std::uint8_t>(v >> 8);
+  }
+  return b;
+}
+
+// Inputs every codec should get back unchanged
+std::vector<Bytes> samples() {
+  return {Bytes{},
+          Bytes{0x42},
+          Bytes(1000, 0x00),
+          textBytes(34, 1),
+          textBytes(70000, 2),
+          sensorBytes(50000, 3),
+          randomBytes(9000, 4)};
+}
+
+bool registered(Algorithm algo) {
+  return findCodec(algo) != nullptr;
+}
+
+Bytes compress(Algorithm algo, const Bytes& in, int level) {
+  Bytes out(compressBound(algo, in.size(), level));
+  const Result r = compressBuffer(algo, in.data(), in.size(), out.data(),
+                                  out.size(), level);
+  EXPECT_EQ(r.error, 0);
+  out.resize(r.bytesOut);
+  return out;
+}
+
+// decompressBuffer of 'in'; the error, with 'out' holding the data
+std::int32_t decompress(const Bytes& in, Bytes& out) {
+  std::uint64_t size = 0;
+  if (!decompressedSize(in.data(), in.size(), size)) {
+    return -3;
+  }
+  out.assign(static_cast<std::size_t>(size), 0);
+  const Result r = decompressBuffer(in.data(), in.size(), out.data(), out.size());
+  return r.error;
+}
+
+Bytes readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return Bytes(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const Bytes& data) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(data.data()),
+            static_cast<std::streamsize>(data.size()));
+}
+
+// A directory of its own for each test's files
+class FileTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    m_dir = std::filesystem::temp_directory_path() /
+            (std::string("CompressionLibTest_") + info->name());
+    std::filesystem::remove_all(m_dir);
+    std::filesystem::create_directories(m_dir);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(m_dir); }
+
+  std::string path(const std::string& name) const { return (m_dir / name).string(); }
+
+  std::filesystem::path m_dir;
+};
+
+// Every level of every codec gives back what went in
+TEST(RoundTrip, BufferEveryCodecAndLevel) {
+  const std::vector<Bytes> inputs = samples();
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    for (int level = kMinLevel; level <= kMaxLevel; ++level) {
+      for (const Bytes& in : inputs) {
+        SCOPED_TRACE(::testing::Message() << "codec " << static_cast<int>(algo)
+                                          << " level " << level << " size "
+                                          << in.size());
+        const Bytes packed = compress(algo, in, level);
+        EXPECT_LE(packed.size(), compressBound(algo, in.size(), level));
+        Bytes out;
+        ASSERT_EQ(decompress(packed, out), 0);
+        EXPECT_EQ(out, in);
+      }
+    }
+  }
+}
+
+// Data over several blocks, coded and decoded on all cores
+TEST(RoundTrip, BufferManyBlocks) {
+  const Bytes in = textBytes(5 * 1024 * 1024 + 123, 5);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    const Bytes packed = compress(algo, in, kDefaultLevel);
+    Bytes out;
+    ASSERT_EQ(decompress(packed, out), 0);
+    EXPECT_EQ(out, in);
+  }
+}
+
+// One context, and so one set of worker threads, reused across jobs of
+// every codec in both directions, with more threads than blocks and
+// fewer
+TEST(RoundTrip, ContextReusedAcrossJobs) {
+  Context ctx(4);
+  const Bytes inputs[] = {textBytes(2 * 1024 * 1024 + 5, 15), textBytes(100000, 16),
+                          sensorBytes(600000, 17)};
+  for (int pass = 0; pass < 3; ++pass) {
+    for (Algorithm algo : kLossless) {
+      if (!registered(algo)) {
+        continue;
+      }
+      for (const Bytes& in : inputs) {
+        SCOPED_TRACE(::testing::Message() << "codec " << static_cast<int>(algo)
+                                          << " size " << in.size());
+        const int level = (pass == 0) ? kMaxLevel : kDefaultLevel;
+        Bytes packed(compressBound(algo, in.size(), level));
+        const Result c = compressBuffer(ctx, algo, in.data(), in.size(),
+                                        packed.data(), packed.size(), level);
+        ASSERT_EQ(c.error, 0);
+        packed.resize(c.bytesOut);
+        Bytes out(in.size());
+        ASSERT_EQ(decompressBuffer(ctx, packed.data(), packed.size(), out.data(),
+                                   out.size()).error, 0);
+        EXPECT_EQ(out, in);
+      }
+    }
+  }
+}
+
+// The container around a tiny input stays small
+TEST(RoundTrip, SmallInputOverhead) {
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    EXPECT_LE(compress(algo, Bytes{}, kDefaultLevel).size(), 9u);
+    EXPECT_LE(compress(algo, Bytes{0x42}, kDefaultLevel).size(), 14u);
+  }
+}
+
+// Buffers are sized by the blocks that can run at once, so a file of
+// one block needs no more memory on eight threads than on one
+TEST(Workspace, BoundedByBlocks) {
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    const Workspace one = compressionWorkspace(algo, kDefaultLevel, 10000, 1);
+    const Workspace eight = compressionWorkspace(algo, kDefaultLevel, 10000, 8);
+    EXPECT_EQ(eight.jobBytes, one.jobBytes);
+  }
+}
+
+TEST_F(FileTest, FileEveryCodec) {
+  const Bytes in = textBytes(3 * 1024 * 1024, 6);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    for (int level : {kMinLevel, kDefaultLevel, kMaxLevel}) {
+      SCOPED_TRACE(::testing::Message() << "codec " << static_cast<int>(algo)
+                                        << " level " << level);
+      const std::string src = path("data.txt");
+      writeFile(src, in);
+      const Result c = compressFile(algo, src, level);
+      ASSERT_EQ(c.error, 0);
+      EXPECT_EQ(c.bytesIn, in.size());
+
+      const std::string packed = src + findCodec(algo)->extension();
+      Algorithm detected = Algorithm::DCT;
+      ASSERT_TRUE(detectAlgorithm(packed, detected));
+      EXPECT_EQ(detected, algo);
+      // The file names its codec, so the caller's choice does not matter
+      ASSERT_EQ(decompressFile(Algorithm::HUFFMAN, packed).error, 0);
+      EXPECT_EQ(readFile(path("data_DC.txt")), in);
+    }
+  }
+}
+
+// A range decodes from just the blocks holding it
+TEST_F(FileTest, Range) {
+  const Bytes in = sensorBytes(3 * 1024 * 1024 + 17, 7);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    const std::string src = path("log.bin");
+    writeFile(src, in);
+    ASSERT_EQ(compressFile(algo, src, kDefaultLevel).error, 0);
+    const std::string packed = src + findCodec(algo)->extension();
+
+    const std::uint64_t offset = 1024 * 1024 - 100;
+    const std::uint64_t length = 300;
+    const Result r = decompressRange(packed, offset, length);
+    ASSERT_EQ(r.error, 0);
+    EXPECT_EQ(r.bytesOut, length);
+    EXPECT_LT(r.bytesIn, std::filesystem::file_size(packed));
+    EXPECT_EQ(readFile(path("log_DC_1048476_300.bin")),
+              Bytes(in.begin() + offset, in.begin() + offset + length));
+
+    // Clipped to the end of the data
+    ASSERT_EQ(decompressRange(packed, in.size() - 5, kContainerToEnd).error, 0);
+    EXPECT_EQ(readFile(path("log_DC_" + std::to_string(in.size() - 5) + "_" +
+                            std::to_string(kContainerToEnd) + ".bin")),
+              Bytes(in.end() - 5, in.end()));
+  }
+}
+
+// Stream output fed back in pieces of every small size decodes to the
+// input, with a flush in the middle
+TEST(RoundTrip, Stream) {
+  const Bytes in = textBytes(300000, 8);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    StreamParams params;
+    params.algo = algo;
+    params.blockSize = 64 * 1024;
+
+    CompressStream writer;
+    ASSERT_EQ(writer.begin(params), 0);
+    Bytes packed;
+    std::uint8_t buffer[1000];
+    auto take = [&](StreamResult r) {
+      EXPECT_EQ(r.error, 0);
+      packed.insert(packed.end(), buffer, buffer + r.produced);
+      return r;
+    };
+    std::size_t at = 0;
+    while (at < in.size()) {
+      const std::size_t n = std::min<std::size_t>(in.size() - at, 7777);
+      std::size_t used = 0;
+      while (used < n) {
+        used += take(writer.update(in.data() + at + used, n - used, buffer,
+                                   sizeof(buffer))).consumed;
+      }
+      at += n;
+      if (at == 7777 * 3) {
+        while (take(writer.flush(buffer, sizeof(buffer))).pending != 0) {
+        }
+      }
+    }
+    while (take(writer.finish(buffer, sizeof(buffer))).pending != 0) {
+    }
+
+    // The whole stream also reads as a buffer
+    Bytes out;
+    ASSERT_EQ(decompress(packed, out), 0);
+    EXPECT_EQ(out, in);
+
+    // The reader learns the codec and block size from the header; a cap
+    // of memoryBytes(params) is enough for it
+    for (std::size_t piece : {1, 3, 7, 4096}) {
+      DecompressStream reader;
+      ASSERT_EQ(reader.begin(piece == 7 ? DecompressStream::memoryBytes(params) : 0), 0);
+      out.clear();
+      for (std::size_t i = 0; i < packed.size();) {
+        const std::size_t n = std::min(piece, packed.size() - i);
+        std::size_t used = 0;
+        while (used < n) {
+          const StreamResult r =
+              reader.update(packed.data() + i + used, n - used, buffer, sizeof(buffer));
+          ASSERT_EQ(r.error, 0);
+          out.insert(out.end(), buffer, buffer + r.produced);
+          used += r.consumed;
+        }
+        i += n;
+      }
+      StreamResult r;
+      do {
+        r = reader.finish(buffer, sizeof(buffer));
+        ASSERT_EQ(r.error, 0);
+        out.insert(out.end(), buffer, buffer + r.produced);
+      } while (r.pending != 0);
+      EXPECT_EQ(out, in);
+    }
+  }
+}
+
+// ---------- Files from before the container ----------
+
+// "basic.csv" -> "basic_DC.csv", as the old decoders name their output
+std::string decodedName(const std::string& name) {
+  const std::size_t dot = name.rfind('.');
+  return name.substr(0, dot) + "_DC" + name.substr(dot);
+}
+
+TEST_F(FileTest, LegacyHuffman) {
+  if (!registered(Algorithm::HUFFMAN)) {
+    GTEST_SKIP();
+  }
+  for (const LegacyFiles::File& file : LegacyFiles::files()) {
+    SCOPED_TRACE(file.name);
+    const std::string packed = path(std::string(file.name) + ".huff");
+    writeFile(packed, file.huff);
+    Algorithm detected = Algorithm::DCT;
+    ASSERT_TRUE(detectAlgorithm(packed, detected));
+    EXPECT_EQ(detected, Algorithm::HUFFMAN);
+    // HUF1 has its magic, so the caller's choice does not matter
+    ASSERT_EQ(decompressFile(Algorithm::LZSS, packed).error, 0);
+    EXPECT_EQ(readFile(path(decodedName(file.name))), file.original);
+  }
+}
+
+TEST_F(FileTest, LegacyLzss) {
+  if (!registered(Algorithm::LZSS)) {
+    GTEST_SKIP();
+  }
+  for (const LegacyFiles::File& file : LegacyFiles::files()) {
+    SCOPED_TRACE(file.name);
+    const std::string packed = path(std::string(file.name) + ".lzss");
+    writeFile(packed, file.lzss);
+    // V1 has no header: only the caller's algo says what it is
+    Algorithm detected = Algorithm::DCT;
+    EXPECT_FALSE(detectAlgorithm(packed, detected));
+    ASSERT_EQ(decompressFile(Algorithm::LZSS, packed).error, 0);
+    EXPECT_EQ(readFile(path(decodedName(file.name))), file.original);
+    // and there is no block index to read a range from
+    EXPECT_EQ(decompressRange(packed, 0, 1).error, -3);
+  }
+}
+
+// ---------- Damaged input ----------
+
+// Every byte of a small container, changed, fails to decode or decodes
+// to the input all the same (the level, a padding bit)
+TEST(Corrupt, EveryByteOfSmallContainer) {
+  const Bytes in = textBytes(2000, 9);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    const Bytes packed = compress(algo, in, kDefaultLevel);
+    for (std::size_t i = 0; i < packed.size(); ++i) {
+      SCOPED_TRACE(::testing::Message() << "codec " << static_cast<int>(algo)
+                                        << " byte " << i);
+      Bytes bad = packed;
+      bad[i] ^= 0x10;
+      Bytes out;
+      const std::int32_t error = decompress(bad, out);
+      if (error == 0) {
+        EXPECT_EQ(out, in);
+      } else {
+        EXPECT_TRUE(error == -2 || error == -3 || error == -4) << error;
+      }
+    }
+  }
+}
+
+TEST(Corrupt, PayloadFailsChecksum) {
+  const Bytes in = randomBytes(3 * 1024 * 1024, 10);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    // Random data is stored, so any changed payload byte decodes
+    Bytes packed = compress(algo, in, kDefaultLevel);
+    packed[packed.size() - 1000] ^= 0x01;
+    Bytes out;
+    EXPECT_EQ(decompress(packed, out), -4);
+  }
+}
+
+TEST(Corrupt, TruncatedAndForeign) {
+  const Bytes in = textBytes(100000, 11);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    const Bytes packed = compress(algo, in, kDefaultLevel);
+    for (std::size_t n : {std::size_t{0}, std::size_t{3}, std::size_t{6},
+                          packed.size() / 2, packed.size() - 1}) {
+      Bytes out;
+      EXPECT_EQ(decompress(Bytes(packed.begin(), packed.begin() + n), out), -3);
+    }
+    // Too little room for the data
+    Bytes out(in.size());
+    EXPECT_EQ(decompressBuffer(packed.data(), packed.size(), out.data(), out.size() - 1).error, -2);
+  }
+  const Bytes text = textBytes(100, 12);
+  Bytes out;
+  EXPECT_EQ(decompress(text, out), -3);
+}
+
+TEST_F(FileTest, CorruptFile) {
+  const Bytes in = textBytes(3 * 1024 * 1024, 13);
+  for (Algorithm algo : kLossless) {
+    if (!registered(algo)) {
+      continue;
+    }
+    SCOPED_TRACE(static_cast<int>(algo));
+    const std::string src = path("data.txt");
+    writeFile(src, in);
+    ASSERT_EQ(compressFile(algo, src, kDefaultLevel).error, 0);
+    const std::string packed = src + findCodec(algo)->extension();
+    const Bytes good = readFile(packed);
+
+    // A flipped bit in the last block's payload
+    Bytes bad = good;
+    bad[bad.size() - 10] ^= 0x04;
+    writeFile(packed, bad);
+    const std::int32_t error = decompressFile(packed).error;
+    EXPECT_TRUE(error == -3 || error == -4) << error;
+
+    // Cut short
+    writeFile(packed, Bytes(good.begin(), good.end() - 1));
+    EXPECT_EQ(decompressFile(packed).error, -3);
+    EXPECT_EQ(decompressRange(packed, 0, 10).error, -3);
+  }
+}
+
+TEST(Corrupt, StreamCutShort) {
+  const Bytes in = textBytes(200000, 14);
+  StreamParams params;
+  params.algo = Algorithm::HUFFMAN;
+  if (!registered(params.algo)) {
+    GTEST_SKIP();
+  }
+  params.blockSize = 64 * 1024;
+  CompressStream writer;
+  ASSERT_EQ(writer.begin(params), 0);
+  Bytes packed(in.size() + 4096);
+  StreamResult w = writer.update(in.data(), in.size(), packed.data(), packed.size());
+  ASSERT_EQ(w.consumed, in.size());
+  std::size_t size = w.produced;
+  w = writer.finish(packed.data() + size, packed.size() - size);
+  ASSERT_EQ(w.pending, 0u);
+  size += w.produced;
+  packed.resize(size);
+
+  Bytes out(in.size());
+  DecompressStream reader;
+  ASSERT_EQ(reader.begin(), 0);
+  StreamResult r = reader.update(packed.data(), packed.size() - 1, out.data(), out.size());
+  EXPECT_EQ(r.error, 0);
+  EXPECT_EQ(reader.finish(out.data(), out.size()).error, -3);
+
+  // A cap below what the stream needs fails it at the header
+  ASSERT_EQ(reader.begin(DecompressStream::memoryBytes(params) / 4), 0);
+  r = reader.update(packed.data(), packed.size(), out.data(), out.size());
+  EXPECT_EQ(r.error, -2);
+  EXPECT_EQ(r.produced, 0u);
+
+  packed[packed.size() / 2] ^= 0x01;
+  ASSERT_EQ(reader.begin(), 0);
+  r = reader.update(packed.data(), packed.size(), out.data(), out.size());
+  EXPECT_TRUE(r.error == -3 || r.error == -4) << r.error;
+}
+
+} // namespace
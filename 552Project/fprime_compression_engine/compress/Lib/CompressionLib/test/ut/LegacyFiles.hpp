@@ -0,0 +1,105 @@
+// Files written by the releases before the container, from test_data/:
+// HUF1 .huff and headerless V1 .lzss, with the data they hold. Nothing
+// writes these formats any more, so they are kept here as bytes.
+
+#ifndef COMPRESSION_LIB_TEST_UT_LEGACY_FILES_HPP
+#define COMPRESSION_LIB_TEST_UT_LEGACY_FILES_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace LegacyFiles {
+
+  struct File {
+    const char* name;
+    std::vector<std::uint8_t> original;
+    std::vector<std::uint8_t> huff; // HUF1
+    std::vector<std::uint8_t> lzss; // V1, no header
+  };
+
+  inline std::vector<File> files() {
+    return {
+      {"empty.bin",
+       {},
+       {0x48, 0x55, 0x46, 0x31, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+       {}},
+      {"one_byte.bin",
+       {0x41},
+       {0x48, 0x55, 0x46, 0x31, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x41, 0x01,
+        0x00, 0x00, 0x00, 0x00},
+       {0x00, 0x41}},
+      {"small_text.txt",
+       {0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20,
+        0x74, 0x65, 0x73, 0x74, 0x20, 0x74, 0x65, 0x73, 0x74, 0x20, 0x63, 0x6f,
+        0x6d, 0x70, 0x72, 0x65, 0x73, 0x73, 0x69, 0x6f, 0x6e, 0x0a},
+       {0x48, 0x55, 0x46, 0x31, 0x22, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x0a, 0x01,
+        0x00, 0x00, 0x00, 0x20, 0x04, 0x00, 0x00, 0x00, 0x63, 0x01, 0x00, 0x00,
+        0x00, 0x65, 0x05, 0x00, 0x00, 0x00, 0x68, 0x02, 0x00, 0x00, 0x00, 0x69,
+        0x01, 0x00, 0x00, 0x00, 0x6c, 0x04, 0x00, 0x00, 0x00, 0x6d, 0x01, 0x00,
+        0x00, 0x00, 0x6e, 0x01, 0x00, 0x00, 0x00, 0x6f, 0x04, 0x00, 0x00, 0x00,
+        0x70, 0x01, 0x00, 0x00, 0x00, 0x72, 0x01, 0x00, 0x00, 0x00, 0x73, 0x04,
+        0x00, 0x00, 0x00, 0x74, 0x04, 0x00, 0x00, 0x00, 0x5e, 0x01, 0x8b, 0xc0,
+        0x32, 0xf7, 0x65, 0xee, 0xcd, 0xce, 0x32, 0x9e, 0xda, 0x0e, 0xb6},
+       {0x40, 0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x20, 0x06, 0x00, 0x06, 0x74, 0x08,
+        0x65, 0x73, 0x74, 0x05, 0x00, 0x06, 0x63, 0x6f, 0x6d, 0x70, 0x00, 0x72,
+        0x65, 0x73, 0x73, 0x69, 0x6f, 0x6e, 0x0a}},
+      {"basic.csv",
+       {0x74, 0x69, 0x6d, 0x65, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x2c, 0x76, 0x61,
+        0x6c, 0x75, 0x65, 0x31, 0x2c, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x32, 0x0a,
+        0x30, 0x2e, 0x30, 0x30, 0x2c, 0x31, 0x2e, 0x32, 0x2c, 0x33, 0x2e, 0x34,
+        0x0a, 0x30, 0x2e, 0x31, 0x30, 0x2c, 0x31, 0x2e, 0x33, 0x2c, 0x33, 0x2e,
+        0x35, 0x0a, 0x30, 0x2e, 0x32, 0x30, 0x2c, 0x31, 0x2e, 0x34, 0x2c, 0x33,
+        0x2e, 0x36, 0x0a},
+       {0x48, 0x55, 0x46, 0x31, 0x3f, 0x00, 0x00, 0x00, 0x14, 0x00, 0x0a, 0x04,
+        0x00, 0x00, 0x00, 0x2c, 0x08, 0x00, 0x00, 0x00, 0x2e, 0x09, 0x00, 0x00,
+        0x00, 0x30, 0x07, 0x00, 0x00, 0x00, 0x31, 0x05, 0x00, 0x00, 0x00, 0x32,
+        0x03, 0x00, 0x00, 0x00, 0x33, 0x04, 0x00, 0x00, 0x00, 0x34, 0x02, 0x00,
+        0x00, 0x00, 0x35, 0x01, 0x00, 0x00, 0x00, 0x36, 0x01, 0x00, 0x00, 0x00,
+        0x61, 0x03, 0x00, 0x00, 0x00, 0x65, 0x03, 0x00, 0x00, 0x00, 0x69, 0x01,
+        0x00, 0x00, 0x00, 0x6c, 0x02, 0x00, 0x00, 0x00, 0x6d, 0x02, 0x00, 0x00,
+        0x00, 0x70, 0x01, 0x00, 0x00, 0x00, 0x73, 0x01, 0x00, 0x00, 0x00, 0x74,
+        0x02, 0x00, 0x00, 0x00, 0x75, 0x02, 0x00, 0x00, 0x00, 0x76, 0x02, 0x00,
+        0x00, 0x00, 0x31, 0xf4, 0x10, 0x18, 0xa9, 0x5b, 0xb9, 0x07, 0x83, 0xee,
+        0xe4, 0x1e, 0x0f, 0x61, 0x64, 0x9f, 0xee, 0xb9, 0xd6, 0x85, 0xbd, 0x3f,
+        0xd2, 0xe7, 0x1d, 0x0b, 0x75, 0x3f, 0xd6, 0x73, 0xaa, 0x80},
+       {0x00, 0x74, 0x69, 0x6d, 0x65, 0x73, 0x74, 0x61, 0x6d, 0x00, 0x70, 0x2c,
+        0x76, 0x61, 0x6c, 0x75, 0x65, 0x31, 0x01, 0x07, 0x00, 0x06, 0x32, 0x0a,
+        0x30, 0x2e, 0x30, 0x30, 0x2c, 0x80, 0x31, 0x2e, 0x32, 0x2c, 0x33, 0x2e,
+        0x34, 0x0d, 0x00, 0x03, 0xaa, 0x31, 0x0d, 0x00, 0x04, 0x33, 0x0d, 0x00,
+        0x03, 0x35, 0x1a, 0x00, 0x03, 0x32, 0x1a, 0x00, 0x04, 0x02, 0x34, 0x1a,
+        0x00, 0x03, 0x36, 0x0a}},
+      {"structured_text.json",
+       {0x7b, 0x0a, 0x20, 0x20, 0x22, 0x73, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x22,
+        0x3a, 0x20, 0x22, 0x54, 0x4d, 0x50, 0x31, 0x30, 0x32, 0x22, 0x2c, 0x0a,
+        0x20, 0x20, 0x22, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x22, 0x3a, 0x20, 0x32,
+        0x32, 0x2e, 0x35, 0x2c, 0x0a, 0x20, 0x20, 0x22, 0x74, 0x69, 0x6d, 0x65,
+        0x73, 0x74, 0x61, 0x6d, 0x70, 0x22, 0x3a, 0x20, 0x31, 0x32, 0x33, 0x34,
+        0x35, 0x36, 0x0a, 0x7d, 0x0a},
+       {0x48, 0x55, 0x46, 0x31, 0x41, 0x00, 0x00, 0x00, 0x1f, 0x00, 0x0a, 0x05,
+        0x00, 0x00, 0x00, 0x20, 0x09, 0x00, 0x00, 0x00, 0x22, 0x08, 0x00, 0x00,
+        0x00, 0x2c, 0x02, 0x00, 0x00, 0x00, 0x2e, 0x01, 0x00, 0x00, 0x00, 0x30,
+        0x01, 0x00, 0x00, 0x00, 0x31, 0x02, 0x00, 0x00, 0x00, 0x32, 0x04, 0x00,
+        0x00, 0x00, 0x33, 0x01, 0x00, 0x00, 0x00, 0x34, 0x01, 0x00, 0x00, 0x00,
+        0x35, 0x02, 0x00, 0x00, 0x00, 0x36, 0x01, 0x00, 0x00, 0x00, 0x3a, 0x03,
+        0x00, 0x00, 0x00, 0x4d, 0x01, 0x00, 0x00, 0x00, 0x50, 0x01, 0x00, 0x00,
+        0x00, 0x54, 0x01, 0x00, 0x00, 0x00, 0x61, 0x02, 0x00, 0x00, 0x00, 0x65,
+        0x03, 0x00, 0x00, 0x00, 0x69, 0x01, 0x00, 0x00, 0x00, 0x6c, 0x01, 0x00,
+        0x00, 0x00, 0x6d, 0x02, 0x00, 0x00, 0x00, 0x6e, 0x01, 0x00, 0x00, 0x00,
+        0x6f, 0x01, 0x00, 0x00, 0x00, 0x70, 0x01, 0x00, 0x00, 0x00, 0x72, 0x01,
+        0x00, 0x00, 0x00, 0x73, 0x03, 0x00, 0x00, 0x00, 0x74, 0x02, 0x00, 0x00,
+        0x00, 0x75, 0x01, 0x00, 0x00, 0x00, 0x76, 0x01, 0x00, 0x00, 0x00, 0x7b,
+        0x01, 0x00, 0x00, 0x00, 0x7d, 0x01, 0x00, 0x00, 0x00, 0x5b, 0xf6, 0x9d,
+        0x16, 0xfa, 0x41, 0x90, 0x34, 0xba, 0xaa, 0xed, 0x4b, 0xce, 0x7e, 0xd1,
+        0x56, 0x12, 0xa0, 0xc0, 0xce, 0xf4, 0x27, 0x9f, 0xb4, 0x3d, 0xe5, 0x1e,
+        0x9d, 0x85, 0x46, 0x06, 0xb3, 0x9a, 0xd2, 0x50, 0xf5, 0xfc},
+       {0x00, 0x7b, 0x0a, 0x20, 0x20, 0x22, 0x73, 0x65, 0x6e, 0x00, 0x73, 0x6f,
+        0x72, 0x22, 0x3a, 0x20, 0x22, 0x54, 0x80, 0x4d, 0x50, 0x31, 0x30, 0x32,
+        0x22, 0x2c, 0x16, 0x00, 0x04, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x15,
+        0x00, 0x03, 0x32, 0x32, 0x04, 0x2e, 0x35, 0x11, 0x00, 0x05, 0x74, 0x69,
+        0x6d, 0x65, 0x73, 0x10, 0x74, 0x61, 0x6d, 0x70, 0x2a, 0x00, 0x03, 0x31,
+        0x32, 0x33, 0x00, 0x34, 0x35, 0x36, 0x0a, 0x7d, 0x0a}}};
+  }
+
+} // namespace LegacyFiles
+
+#endif